@@ -1,4 +1,9 @@
 #include "asteroid.h"
+#include "quaternion_batch.h"
+#include "job_system.h"
+
+// Number of asteroids of a field rotated by one job
+#define ASTEROID_CHUNK_SIZE 4096
 
 namespace game {
 
@@ -26,5 +31,43 @@ void Asteroid::Update(void){
 
     Rotate(angm_);
 }
+
+
+AsteroidField::AsteroidField(const std::string name, const Resource *geometry, const Resource *material) : InstancedNode(name, geometry, material) {
+}
+
+
+AsteroidField::~AsteroidField(){
+}
+
+
+int AsteroidField::AddAsteroid(glm::vec3 position, glm::quat orientation, glm::quat angm){
+
+    angm_.push_back(angm);
+    return AddInstance(position, orientation);
+}
+
+
+glm::quat AsteroidField::GetAngM(int index) const {
+
+    return angm_[index];
+}
+
+
+void AsteroidField::SetAngM(int index, glm::quat angm){
+
+    angm_[index] = angm;
+}
+
+
+void AsteroidField::Update(void){
+
+    // Orientations and angular momenta are packed arrays, so rotate them in
+    // batches; large fields are split over the worker threads
+    JobSystem::GetInstance().ParallelFor((int) angm_.size(), ASTEROID_CHUNK_SIZE, [this](int begin, int end){
+        RotateQuaternions(&instance_orientation_[begin], &angm_[begin], end - begin);
+    });
+    InvalidateInstances(false);
+}
             
 } // namespace game
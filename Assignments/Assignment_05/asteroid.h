@@ -2,6 +2,7 @@
 #define ASTEROID_H_
 
 #include <string>
+#include <vector>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -11,6 +12,7 @@
 
 #include "resource.h"
 #include "scene_node.h"
+#include "instanced_node.h"
 
 namespace game {
 
@@ -36,6 +38,31 @@ namespace game {
             glm::quat angm_;
     }; // class Asteroid
 
+    // A field of asteroids drawn with one instanced draw call
+    class AsteroidField : public InstancedNode {
+
+        public:
+            // Create asteroid field from given resources
+            AsteroidField(const std::string name, const Resource *geometry, const Resource *material);
+
+            // Destructor
+            ~AsteroidField();
+
+            // Add an asteroid and return its index
+            int AddAsteroid(glm::vec3 position, glm::quat orientation, glm::quat angm);
+
+            // Get/set angular momentum of an asteroid
+            glm::quat GetAngM(int index) const;
+            void SetAngM(int index, glm::quat angm);
+
+            // Rotate all asteroids by their angular momentum
+            void Update(void);
+
+        private:
+            // Angular momentum of each asteroid
+            std::vector<glm::quat> angm_;
+    }; // class AsteroidField
+
 } // namespace game
 
 #endif // ASTEROID_H_
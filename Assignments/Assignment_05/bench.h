@@ -0,0 +1,32 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <chrono>
+
+// Helpers shared by the benchmark programs (bench_*.cpp)
+
+// Number of times each benchmark is run; the fastest run is reported
+#define BENCH_REPEATS 5
+
+namespace game {
+
+    // Run a function the given number of times and return the duration of
+    // the fastest run in seconds, the one least disturbed by the rest of
+    // the system
+    template <typename F> double TimeBest(int repeats, F function){
+
+        double best = 0.0;
+        for (int r = 0; r < repeats; r++){
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            function();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if ((r == 0) || (seconds < best)){
+                best = seconds;
+            }
+        }
+        return best;
+    }
+
+} // namespace game
+
+#endif // BENCH_H_
@@ -0,0 +1,324 @@
+/*
+ *
+ * Benchmark of OBJ parsing: LoadObj, which reads the memory-mapped file in
+ * place, against the line-by-line parser it replaced (kept below, as it
+ * was). Only parsing is timed; no mesh is built or uploaded
+ *
+ * Usage: bench_obj_loader [file.obj]
+ * Without a file, a grid of about three million triangles with texture
+ * coordinates and normals is generated, timed, and deleted
+ *
+ * Both parsers must produce the same TriMesh
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <filesystem>
+
+#include "bench.h"
+#include "model_loader.h"
+
+// Number of quads along each side of the generated grid; each quad is
+// split into two triangles
+#define GRID_SIZE 1225
+
+using namespace game;
+
+// Parser used by ResourceManager::LoadMesh before LoadObj
+namespace legacy {
+
+void string_trim(std::string str, std::string to_trim){
+
+    // Trim any character in to_trim from the beginning of the string str
+    while ((str.size() > 0) && 
+           (to_trim.find(str[0]) != std::string::npos)){
+        str.erase(0);
+    }
+
+    // Trim any character in to_trim from the end of the string str
+    while ((str.size() > 0) && 
+           (to_trim.find(str[str.size()-1]) != std::string::npos)){
+        str.erase(str.size()-1);
+    }
+}
+
+
+std::vector<std::string> string_split(std::string str, std::string separator){
+
+    // Initialize output
+    std::vector<std::string> output;
+    output.push_back(std::string(""));
+    int string_index = 0;
+
+    // Analyze string
+    unsigned int i = 0;
+    while (i < str.size()){
+        // Check if character i is a separator
+        if (separator.find(str[i]) != std::string::npos){
+            // Split string
+            string_index++;
+            output.push_back(std::string(""));
+            // Skip separators
+            while ((i < str.size()) && (separator.find(str[i]) != std::string::npos)){
+                i++;
+            }
+        } else {
+            // Otherwise, copy string
+            output[string_index] += str[i];
+            i++;
+        }
+    }
+
+    return output;
+}
+
+
+std::vector<std::string> string_split_once(std::string str, std::string separator){
+
+    // Initialize output
+    std::vector<std::string> output;
+    output.push_back(std::string(""));
+    int string_index = 0;
+
+    // Analyze string
+    unsigned int i = 0;
+    while (i < str.size()){
+        // Check if character i is a separator
+        if (separator.find(str[i]) != std::string::npos){
+            // Split string
+            string_index++;
+            output.push_back(std::string(""));
+            // Skip single separator
+            i++;
+        } else {
+            // Otherwise, copy string
+            output[string_index] += str[i];
+            i++;
+        }
+    }
+
+    return output;
+}
+
+
+template <typename T> T str_to_num(const std::string &str){
+
+    std::istringstream ss(str);
+    T result;
+    ss >> result;
+    if (ss.fail()){
+        throw(std::ios_base::failure(std::string("Invalid number: ")+str));
+    }
+    return result;
+}
+
+
+// Read the vertices of an f command
+void read_face_vertices(const std::vector<std::string> &part, int count, int *i, int *t, int *n){
+
+    std::string face_separator("/");
+    for (int k = 0; k < count; k++){
+        std::vector<std::string> fd = string_split_once(part[k+1], face_separator);
+        if (fd.size() == 1){
+            i[k] = str_to_num<float>(fd[0].c_str())-1;
+            t[k] = -1;
+            n[k] = -1;
+        } else if (fd.size() == 2){
+            i[k] = str_to_num<float>(fd[0].c_str())-1;
+            t[k] = str_to_num<float>(fd[1].c_str())-1;
+            n[k] = -1;
+        } else if (fd.size() == 3){
+            i[k] = str_to_num<float>(fd[0].c_str())-1;
+            if (std::string("").compare(fd[1]) != 0){
+                t[k] = str_to_num<float>(fd[1].c_str())-1;
+            } else {
+                t[k] = -1;
+            }
+            n[k] = str_to_num<float>(fd[2].c_str())-1;
+        } else {
+            throw(std::ios_base::failure(std::string("Error: f parameter should have 1, 2, or 3 parameters separated by '/'")));
+        }
+    }
+}
+
+
+void load_obj(const std::string &filename, TriMesh &mesh){
+
+    // Open file
+    std::ifstream f;
+    f.open(filename);
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error opening file ")+filename));
+    }
+
+    // Parse lines
+    std::string line;
+    std::string ignore(" \t\r\n");
+    std::string part_separator(" \t");
+    while (std::getline(f, line)){
+        // Clean extremities of the string
+        string_trim(line, ignore);
+        // Ignore comments
+        if ((line.size() <= 0) ||
+            (line[0] == '#')){
+            continue;
+        }
+        // Parse string
+        std::vector<std::string> part = string_split(line, part_separator);
+        // Check commands
+        if (!part[0].compare(std::string("v"))){
+            if (part.size() >= 4){
+                glm::vec3 position(str_to_num<float>(part[1].c_str()), str_to_num<float>(part[2].c_str()), str_to_num<float>(part[3].c_str()));
+                mesh.position.push_back(position);
+            } else {
+                throw(std::ios_base::failure(std::string("Error: v command should have exactly 3 parameters")));
+            }
+        } else if (!part[0].compare(std::string("vn"))){
+            if (part.size() >= 4){
+                glm::vec3 normal(str_to_num<float>(part[1].c_str()), str_to_num<float>(part[2].c_str()), str_to_num<float>(part[3].c_str()));
+                mesh.normal.push_back(normal);
+            } else {
+                throw(std::ios_base::failure(std::string("Error: vn command should have exactly 3 parameters")));
+            }
+        } else if (!part[0].compare(std::string("vt"))){
+            if (part.size() >= 3){
+                glm::vec2 tex_coord(str_to_num<float>(part[1].c_str()), str_to_num<float>(part[2].c_str()));
+                mesh.tex_coord.push_back(tex_coord);
+            } else {
+                throw(std::ios_base::failure(std::string("Error: vt command should have exactly 2 parameters")));
+            }
+        } else if (!part[0].compare(std::string("f"))){
+            if (part.size() >= 4){
+                if (part.size() > 5){
+                    throw(std::ios_base::failure(std::string("Error: f commands with more than 4 vertices not supported")));
+                } else if (part.size() == 5){
+                    // Break a quad into two triangles
+                    Quad quad;
+                    read_face_vertices(part, 4, quad.i, quad.t, quad.n);
+                    Face face1, face2;
+                    face1.i[0] = quad.i[0]; face1.i[1] = quad.i[1]; face1.i[2] = quad.i[2];
+                    face1.n[0] = quad.n[0]; face1.n[1] = quad.n[1]; face1.n[2] = quad.n[2];
+                    face1.t[0] = quad.t[0]; face1.t[1] = quad.t[1]; face1.t[2] = quad.t[2];
+                    face2.i[0] = quad.i[0]; face2.i[1] = quad.i[2]; face2.i[2] = quad.i[3];
+                    face2.n[0] = quad.n[0]; face2.n[1] = quad.n[2]; face2.n[2] = quad.n[3];
+                    face2.t[0] = quad.t[0]; face2.t[1] = quad.t[2]; face2.t[2] = quad.t[3];
+                    mesh.face.push_back(face1);
+                    mesh.face.push_back(face2);
+                } else if (part.size() == 4){
+                    Face face;
+                    read_face_vertices(part, 3, face.i, face.t, face.n);
+                    mesh.face.push_back(face);
+                }
+            } else {
+                throw(std::ios_base::failure(std::string("Error: f command should have 3 or 4 parameters")));
+            }
+        }
+        // Ignore other commands
+    }
+
+    // Close file
+    f.close();
+}
+
+} // namespace legacy
+
+
+// Write a grid of quads bent into a torus, with texture coordinates and
+// normals, as an OBJ file
+static void WriteGrid(const std::string &filename, int size){
+
+    std::ofstream f(filename);
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error creating file ")+filename));
+    }
+    f << "# Generated by bench_obj_loader" << std::endl;
+    f << std::setprecision(7);
+    const float pi = 3.14159265f;
+    for (int i = 0; i <= size; i++){
+        for (int j = 0; j <= size; j++){
+            float theta = 2.0f*pi*i/size, phi = 2.0f*pi*j/size;
+            glm::vec3 normal(cos(theta)*cos(phi), sin(theta)*cos(phi), sin(phi));
+            glm::vec3 position = glm::vec3(cos(theta), sin(theta), 0.0)*0.6f + normal*0.2f;
+            f << "v " << position.x << " " << position.y << " " << position.z << "\n";
+            f << "vt " << (float) i/size << " " << (float) j/size << "\n";
+            f << "vn " << normal.x << " " << normal.y << " " << normal.z << "\n";
+        }
+    }
+    for (int i = 0; i < size; i++){
+        for (int j = 0; j < size; j++){
+            int corner[4] = {i*(size + 1) + j + 1, (i + 1)*(size + 1) + j + 1, (i + 1)*(size + 1) + j + 2, i*(size + 1) + j + 2};
+            f << "f";
+            for (int k = 0; k < 4; k++){
+                f << " " << corner[k] << "/" << corner[k] << "/" << corner[k];
+            }
+            f << "\n";
+        }
+    }
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error writing file ")+filename));
+    }
+}
+
+
+// Compare two meshes; floats must match bit for bit
+static bool SameMesh(const TriMesh &a, const TriMesh &b){
+
+    if ((a.position.size() != b.position.size()) || (a.normal.size() != b.normal.size()) ||
+        (a.tex_coord.size() != b.tex_coord.size()) || (a.face.size() != b.face.size())){
+        return false;
+    }
+    return ((a.position.empty() || !memcmp(&a.position[0], &b.position[0], a.position.size()*sizeof(glm::vec3))) &&
+            (a.normal.empty() || !memcmp(&a.normal[0], &b.normal[0], a.normal.size()*sizeof(glm::vec3))) &&
+            (a.tex_coord.empty() || !memcmp(&a.tex_coord[0], &b.tex_coord[0], a.tex_coord.size()*sizeof(glm::vec2))) &&
+            (a.face.empty() || !memcmp(&a.face[0], &b.face[0], a.face.size()*sizeof(Face))));
+}
+
+
+int main(int argc, char *argv[]){
+
+    try {
+        std::string filename;
+        bool generated = (argc < 2);
+        if (generated){
+            filename = (std::filesystem::temp_directory_path() / "bench_obj_loader.obj").string();
+            std::cout << "Generating " << filename << std::endl;
+            WriteGrid(filename, GRID_SIZE);
+        } else {
+            filename = argv[1];
+        }
+
+        // The old parser is slow on large files, so it runs once
+        TriMesh expected;
+        double legacy_time = TimeBest(1, [&](){
+            legacy::load_obj(filename, expected);
+        });
+        TriMesh mesh;
+        double time = TimeBest(BENCH_REPEATS, [&](){
+            mesh = TriMesh();
+            LoadObj(filename, mesh);
+        });
+        bool same = SameMesh(mesh, expected);
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << filename << ": " << std::filesystem::file_size(filename) / (1024*1024) << " MB, "
+                  << mesh.position.size() << " positions, " << mesh.face.size() << " triangles" << std::endl;
+        std::cout << "Old parser: " << legacy_time << " s" << std::endl;
+        std::cout << "LoadObj:    " << time << " s (" << legacy_time / time << " times faster)" << std::endl;
+        std::cout << "Same mesh:  " << (same ? "yes" : "NO") << std::endl;
+
+        if (generated){
+            std::filesystem::remove(filename);
+        }
+        return same ? 0 : 1;
+    }
+    catch (std::exception &e){
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
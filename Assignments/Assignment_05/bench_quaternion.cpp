@@ -0,0 +1,152 @@
+/*
+ *
+ * Benchmark of the asteroid rotation: the per-node path (one virtual
+ * Asteroid::Update per asteroid) against the batched quaternion kernels
+ * and the whole AsteroidField::Update (kernels spread over the job
+ * system), for fields of different sizes
+ *
+ * Every method is checked against rotating the same quaternions with glm
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+#include "bench.h"
+#include "asteroid.h"
+#include "quaternion_batch.h"
+#include "job_system.h"
+#include "random.h"
+
+// Largest difference allowed between a component computed by a method and
+// by glm
+#define MAX_ERROR 1e-5f
+
+using namespace game;
+
+// Largest difference between components of two arrays of quaternions
+static float MaxDifference(const std::vector<glm::quat> &a, const std::vector<glm::quat> &b){
+
+    float error = 0.0;
+    for (unsigned int i = 0; i < a.size(); i++){
+        for (int k = 0; k < 4; k++){
+            error = std::max(error, std::abs(a[i][k] - b[i][k]));
+        }
+    }
+    return error;
+}
+
+
+static bool RunBenchmark(int num_asteroids, const Resource *geometry, const Resource *material){
+
+    // Random orientations and angular momenta, as in Game::CreateAsteroidField
+    Random random(RANDOM_DEFAULT_SEED, AsteroidStream);
+    std::vector<glm::quat> orientation(num_asteroids), angm(num_asteroids);
+    for (int i = 0; i < num_asteroids; i++){
+        float r[8];
+        random.Uniform(r, 8);
+        orientation[i] = glm::normalize(glm::angleAxis(glm::pi<float>()*r[0], glm::vec3(r[1], r[2], r[3])));
+        angm[i] = glm::normalize(glm::angleAxis(0.05f*glm::pi<float>()*r[4], glm::vec3(r[5], r[6], r[7])));
+    }
+
+    // Expected result of one update
+    std::vector<glm::quat> expected(orientation);
+    for (int i = 0; i < num_asteroids; i++){
+        expected[i] = glm::normalize(expected[i] * angm[i]);
+    }
+    float error = 0.0;
+
+    // Per-node path
+    std::vector<SceneNode *> node(num_asteroids);
+    for (int i = 0; i < num_asteroids; i++){
+        Asteroid *asteroid = new Asteroid("Asteroid", geometry, material);
+        asteroid->SetOrientation(orientation[i]);
+        asteroid->SetAngM(angm[i]);
+        node[i] = asteroid;
+    }
+    for (int i = 0; i < num_asteroids; i++){
+        node[i]->Update();
+    }
+    std::vector<glm::quat> result(num_asteroids);
+    for (int i = 0; i < num_asteroids; i++){
+        result[i] = node[i]->GetOrientation();
+    }
+    error = std::max(error, MaxDifference(result, expected));
+    double per_node = TimeBest(BENCH_REPEATS, [&](){
+        for (int i = 0; i < num_asteroids; i++){
+            node[i]->Update();
+        }
+    });
+    for (int i = 0; i < num_asteroids; i++){
+        delete node[i];
+    }
+
+    // Kernels on one thread; a kernel that was not compiled in is reported
+    // with a negative time
+    double kernel_time[3];
+    for (int k = 0; k < 3; k++){
+        QuaternionKernel kernel = (QuaternionKernel) k;
+        kernel_time[k] = -1.0;
+        if (!HasQuaternionKernel(kernel)){
+            continue;
+        }
+        result = orientation;
+        RotateQuaternions(&result[0], &angm[0], num_asteroids, kernel);
+        error = std::max(error, MaxDifference(result, expected));
+        kernel_time[k] = TimeBest(BENCH_REPEATS, [&](){
+            RotateQuaternions(&result[0], &angm[0], num_asteroids, kernel);
+        });
+    }
+
+    // Whole field update, on all threads
+    AsteroidField field("AsteroidField", geometry, material);
+    for (int i = 0; i < num_asteroids; i++){
+        field.AddAsteroid(glm::vec3(0.0, 0.0, 0.0), orientation[i], angm[i]);
+    }
+    field.Update();
+    for (int i = 0; i < num_asteroids; i++){
+        result[i] = field.GetInstanceOrientation(i);
+    }
+    error = std::max(error, MaxDifference(result, expected));
+    double field_time = TimeBest(BENCH_REPEATS, [&](){
+        field.Update();
+    });
+
+    // Time per update in milliseconds
+    std::cout << std::setw(10) << num_asteroids << std::setw(12) << per_node*1e3;
+    for (int k = 0; k < 3; k++){
+        if (kernel_time[k] < 0.0){
+            std::cout << std::setw(12) << "-";
+        } else {
+            std::cout << std::setw(12) << kernel_time[k]*1e3;
+        }
+    }
+    std::cout << std::setw(12) << field_time*1e3 << std::setw(12) << std::scientific << std::setprecision(1) << error << std::fixed << std::setprecision(3) << std::endl;
+    return error <= MAX_ERROR;
+}
+
+
+int main(void){
+
+    // The asteroids are never drawn, so their resources are placeholders
+    // without OpenGL objects
+    Resource geometry(Mesh, "SimpleSphereMesh", FullVertexFormat);
+    Resource material(Material, "InstancedObjectMaterial", FullVertexFormat);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Asteroid rotation, ms per update (" << JobSystem::GetInstance().GetNumThreads() << " threads for the field)" << std::endl;
+    std::cout << std::setw(10) << "asteroids" << std::setw(12) << "per node" << std::setw(12) << "scalar" << std::setw(12) << "SSE" << std::setw(12) << "AVX" << std::setw(12) << "field" << std::setw(12) << "max error" << std::endl;
+
+    bool correct = true;
+    const int num_asteroids[3] = {1500, 100000, 1000000};
+    for (int i = 0; i < 3; i++){
+        correct = RunBenchmark(num_asteroids[i], &geometry, &material) && correct;
+    }
+    if (!correct){
+        std::cout << "Results differ from glm by more than " << MAX_ERROR << std::endl;
+    }
+
+    return correct ? 0 : 1;
+}
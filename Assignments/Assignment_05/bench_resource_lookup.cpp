@@ -0,0 +1,119 @@
+/*
+ *
+ * Benchmark of resource lookups: by name and by handle in the
+ * ResourceManager, against the linear scan over all resources that
+ * GetResource used before resources were indexed
+ *
+ * Resources are placeholders registered without OpenGL objects, so no
+ * OpenGL context is needed
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "resource_manager.h"
+#include "model_loader.h"
+
+// Number of lookups timed for each number of resources
+#define NUM_LOOKUPS 200000
+
+using namespace game;
+
+// Receives the results of the timed loops, so that they are not optimized
+// away
+volatile size_t sink;
+
+// Lookup by name as GetResource did before the name index
+static Resource *FindResourceLinear(const std::vector<Resource *> &resource, const std::string &name){
+
+    for (unsigned int i = 0; i < resource.size(); i++){
+        if (resource[i]->GetName() == name){
+            return resource[i];
+        }
+    }
+    return NULL;
+}
+
+
+static bool RunBenchmark(int num_resources){
+
+    // Register the resources under names like those of the game
+    ResourceManager resman;
+    std::vector<Resource *> resource;
+    std::vector<std::string> name;
+    for (int i = 0; i < num_resources; i++){
+        name.push_back(std::string("Resource") + num_to_str(i) + std::string("Mesh"));
+        resource.push_back(resman.AddResource(Texture, name.back(), 0, 0));
+    }
+
+    // Look resources up in a scattered order, the same for all methods
+    std::vector<int> order(NUM_LOOKUPS);
+    unsigned int state = 1;
+    for (int i = 0; i < NUM_LOOKUPS; i++){
+        state = state*1664525u + 1013904223u;
+        order[i] = (int) (state % (unsigned int) num_resources);
+    }
+    std::vector<ResourceHandle> handle(num_resources);
+    for (int i = 0; i < num_resources; i++){
+        handle[i] = resman.GetResourceHandle(name[i]);
+    }
+
+    // Check that all methods find the same resources
+    bool correct = true;
+    for (int i = 0; i < num_resources; i++){
+        Resource *expected = FindResourceLinear(resource, name[i]);
+        if ((resman.GetResource(name[i]) != expected) || (resman.GetResource(handle[i]) != expected) || (expected != resource[i])){
+            correct = false;
+        }
+    }
+
+    // The linear scan is slow with many resources, so it does fewer
+    // lookups and the time is scaled
+    int num_linear = (num_resources > 1000) ? NUM_LOOKUPS/100 : NUM_LOOKUPS;
+    size_t sum = 0;
+    double linear = TimeBest(BENCH_REPEATS, [&](){
+        for (int i = 0; i < num_linear; i++){
+            sum += (size_t) FindResourceLinear(resource, name[order[i]]);
+        }
+    }) * NUM_LOOKUPS / num_linear;
+    double by_name = TimeBest(BENCH_REPEATS, [&](){
+        for (int i = 0; i < NUM_LOOKUPS; i++){
+            sum += (size_t) resman.GetResource(name[order[i]]);
+        }
+    });
+    double by_handle = TimeBest(BENCH_REPEATS, [&](){
+        for (int i = 0; i < NUM_LOOKUPS; i++){
+            sum += (size_t) resman.GetResource(handle[order[i]]);
+        }
+    });
+
+    // Time per lookup in nanoseconds
+    double scale = 1e9 / NUM_LOOKUPS;
+    std::cout << std::setw(10) << num_resources
+              << std::setw(14) << linear*scale
+              << std::setw(14) << by_name*scale
+              << std::setw(14) << by_handle*scale
+              << std::setw(10) << (correct ? "yes" : "NO") << std::endl;
+    sink = sum;
+    return correct;
+}
+
+
+int main(void){
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Resource lookup, ns per lookup" << std::endl;
+    std::cout << std::setw(10) << "resources" << std::setw(14) << "linear scan" << std::setw(14) << "by name" << std::setw(14) << "by handle" << std::setw(10) << "same" << std::endl;
+
+    bool correct = true;
+    const int num_resources[4] = {10, 100, 1000, 10000};
+    for (int i = 0; i < 4; i++){
+        correct = RunBenchmark(num_resources[i]) && correct;
+    }
+
+    return correct ? 0 : 1;
+}
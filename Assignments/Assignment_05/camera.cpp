@@ -4,12 +4,15 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
+#include <cfloat>
 
 #include "camera.h"
 
 namespace game {
 
 Camera::Camera(void){
+
+    pixel_scale_ = 1.0;
 }
 
 
@@ -123,21 +126,60 @@ void Camera::SetProjection(GLfloat fov, GLfloat near, GLfloat far, GLfloat w, GL
     float top = tan((fov/2.0)*(glm::pi<float>()/180.0))*near;
     float right = top * w/h;
     projection_matrix_ = glm::frustum(-right, right, -top, top, near, far);
+
+    // The viewport spans 2*top/near units at distance 1
+    pixel_scale_ = (h/2.0) * near / top;
 }
 
 
-void Camera::SetupShader(GLuint program){
+float Camera::GetProjectedRadius(glm::vec3 center, float radius) const {
+
+    float distance = glm::length(center - position_);
+    // The camera is inside the sphere
+    if (distance <= radius){
+        return FLT_MAX;
+    }
+    return radius * pixel_scale_ / distance;
+}
+
+
+void Camera::SetupShader(const MaterialLocations &locations){
 
     // Update view matrix
     SetupViewMatrix();
 
     // Set view matrix in shader
-    GLint view_mat = glGetUniformLocation(program, "view_mat");
-    glUniformMatrix4fv(view_mat, 1, GL_FALSE, glm::value_ptr(view_matrix_));
+    glUniformMatrix4fv(locations.view_mat, 1, GL_FALSE, glm::value_ptr(view_matrix_));
     
     // Set projection matrix in shader
-    GLint projection_mat = glGetUniformLocation(program, "projection_mat");
-    glUniformMatrix4fv(projection_mat, 1, GL_FALSE, glm::value_ptr(projection_matrix_));
+    glUniformMatrix4fv(locations.projection_mat, 1, GL_FALSE, glm::value_ptr(projection_matrix_));
+}
+
+
+void Camera::GetFrustumPlanes(glm::vec4 planes[6]){
+
+    // Update view matrix
+    SetupViewMatrix();
+
+    // Extract the planes from the rows of the combined matrix
+    // (Gribb and Hartmann). Note that glm matrices are indexed as
+    // matrix[column][row]
+    glm::mat4 m = projection_matrix_ * view_matrix_;
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++){
+        row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+    planes[0] = row[3] + row[0]; // Left
+    planes[1] = row[3] - row[0]; // Right
+    planes[2] = row[3] + row[1]; // Bottom
+    planes[3] = row[3] - row[1]; // Top
+    planes[4] = row[3] + row[2]; // Near
+    planes[5] = row[3] - row[2]; // Far
+
+    // Normalize, so that plane equations give distances
+    for (int i = 0; i < 6; i++){
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
 }
 
 
@@ -6,6 +6,7 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "resource.h"
 
 namespace game {
 
@@ -45,8 +46,17 @@ namespace game {
             // Set projection from frustum parameters: field-of-view,
             // near and far planes, and width and height of viewport
             void SetProjection(GLfloat fov, GLfloat near, GLfloat far, GLfloat w, GLfloat h);
-            // Set all camera-related variables in shader program
-            void SetupShader(GLuint program);
+            // Get the six planes of the view frustum (left, right, bottom,
+            // top, near, far) in world coordinates, as (a, b, c, d) with
+            // a*x + b*y + c*z + d >= 0 inside and (a, b, c) normalized
+            void GetFrustumPlanes(glm::vec4 planes[6]);
+            // Get the radius in pixels of a sphere seen by the camera (an
+            // estimate based on its distance, ignoring where it is in the
+            // view); used to select levels of detail
+            float GetProjectedRadius(glm::vec3 center, float radius) const;
+            // Set all camera-related variables in the current shader
+            // program, given the locations cached for its material
+            void SetupShader(const MaterialLocations &locations);
 
         private:
             glm::vec3 position_; // Position of camera
@@ -55,6 +65,9 @@ namespace game {
             glm::vec3 side_; // Initial side vector
             glm::mat4 view_matrix_; // View matrix
             glm::mat4 projection_matrix_; // Projection matrix
+            // Pixels per unit of length at distance 1 along the view
+            // direction, given the field-of-view and viewport height
+            float pixel_scale_;
 
             // Create view matrix from current camera parameters
             void SetupViewMatrix(void);
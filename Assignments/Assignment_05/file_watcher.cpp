@@ -0,0 +1,142 @@
+#include <filesystem>
+#include <system_error>
+#include <unordered_set>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include "file_watcher.h"
+
+namespace game {
+
+// Normalized form of a path, so that the names reported for a directory
+// match the names of the watched files
+static std::string NormalizePath(const std::filesystem::path &path){
+
+    std::filesystem::path normal = path.lexically_normal();
+    if (normal.parent_path().empty()){
+        normal = std::filesystem::path(".") / normal;
+    }
+    return normal.string();
+}
+
+
+FileWatcher::FileWatcher(void){
+
+    inotify_ = -1;
+#ifdef __linux__
+    inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    last_poll_ = std::chrono::steady_clock::now();
+}
+
+
+FileWatcher::~FileWatcher(){
+
+#ifdef __linux__
+    if (inotify_ >= 0){
+        close(inotify_);
+    }
+#endif
+}
+
+
+void FileWatcher::AddFile(const std::string &filename){
+
+    std::string path = NormalizePath(filename);
+    if (file_.count(path)){
+        return;
+    }
+    WatchedFile watched;
+    watched.filename = filename;
+    watched.time = GetModificationTime(path);
+    file_[path] = watched;
+
+#ifdef __linux__
+    if (inotify_ >= 0){
+        // Watch the directory once; the events name the file
+        std::string directory = std::filesystem::path(path).parent_path().string();
+        for (std::unordered_map<int, std::string>::const_iterator it = directory_.begin(); it != directory_.end(); ++it){
+            if (it->second == directory){
+                return;
+            }
+        }
+        // Files are reported once written and closed, or renamed into
+        // place; not on creation, when they may still be empty
+        int wd = inotify_add_watch(inotify_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd >= 0){
+            directory_[wd] = directory;
+        } else {
+            // Fall back to polling all files
+            close(inotify_);
+            inotify_ = -1;
+            directory_.clear();
+        }
+    }
+#endif
+}
+
+
+void FileWatcher::GetModifiedFiles(std::vector<std::string> &modified){
+
+    // Several events may concern the same file
+    std::unordered_set<std::string> found;
+
+#ifdef __linux__
+    if (inotify_ >= 0){
+        // Read all pending events without blocking
+        alignas(struct inotify_event) char buffer[4096];
+        while (true){
+            ssize_t length = read(inotify_, buffer, sizeof(buffer));
+            if (length <= 0){
+                break;
+            }
+            for (char *p = buffer; p < buffer + length; ){
+                const struct inotify_event *event = (const struct inotify_event *) p;
+                p += sizeof(struct inotify_event) + event->len;
+                std::unordered_map<int, std::string>::const_iterator directory = directory_.find(event->wd);
+                if ((directory == directory_.end()) || (event->len == 0)){
+                    continue;
+                }
+                std::string path = NormalizePath(std::filesystem::path(directory->second) / event->name);
+                std::unordered_map<std::string, WatchedFile>::const_iterator it = file_.find(path);
+                if ((it != file_.end()) && found.insert(path).second){
+                    modified.push_back(it->second.filename);
+                }
+            }
+        }
+        return;
+    }
+#endif
+
+    // Poll the modification times now and then
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - last_poll_ < std::chrono::milliseconds(FILE_WATCH_POLL_INTERVAL_MS)){
+        return;
+    }
+    last_poll_ = now;
+    for (std::unordered_map<std::string, WatchedFile>::iterator it = file_.begin(); it != file_.end(); ++it){
+        int64_t time = GetModificationTime(it->first);
+        if (time != it->second.time){
+            it->second.time = time;
+            if (time >= 0){
+                modified.push_back(it->second.filename);
+            }
+        }
+    }
+}
+
+
+int64_t FileWatcher::GetModificationTime(const std::string &path){
+
+    std::error_code error;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    if (error){
+        return -1;
+    }
+    return (int64_t) time.time_since_epoch().count();
+}
+
+} // namespace game
@@ -0,0 +1,62 @@
+#ifndef FILE_WATCHER_H_
+#define FILE_WATCHER_H_
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+// Time between two checks of the modification times of the watched files,
+// when the operating system cannot report changes
+#define FILE_WATCH_POLL_INTERVAL_MS 500
+
+namespace game {
+
+    // Reports changes to a set of files
+    // On Linux, the directories of the files are watched with inotify, so
+    // that files replaced by a rename (as many editors save) are noticed
+    // too; elsewhere, or if inotify is not available, the modification
+    // times of the files are polled
+    class FileWatcher {
+
+        public:
+            FileWatcher(void);
+            ~FileWatcher();
+
+            // Start watching a file; the file does not need to exist yet
+            void AddFile(const std::string &filename);
+
+            // Append the watched files (as passed to AddFile) that were
+            // modified, created or replaced since the last call, each once
+            void GetModifiedFiles(std::vector<std::string> &modified);
+
+        private:
+            // Watched files, by normalized path, with the name they were
+            // added under and their last modification time (polling only;
+            // -1 if missing)
+            struct WatchedFile {
+                std::string filename;
+                int64_t time;
+            };
+            std::unordered_map<std::string, WatchedFile> file_;
+
+            // inotify instance (-1 if not used), and watched directories by
+            // watch descriptor
+            int inotify_;
+            std::unordered_map<int, std::string> directory_;
+
+            std::chrono::steady_clock::time_point last_poll_;
+
+            // Modification time of a file, or -1 if it does not exist
+            static int64_t GetModificationTime(const std::string &path);
+
+            // Watchers cannot be copied
+            FileWatcher(const FileWatcher &);
+            FileWatcher &operator=(const FileWatcher &);
+
+    }; // class FileWatcher
+
+} // namespace game
+
+#endif // FILE_WATCHER_H_
@@ -28,8 +28,11 @@ glm::vec3 camera_up_g(0.0, 1.0, 0.0);
 // Materials 
 const std::string material_directory_g = MATERIAL_DIRECTORY;
 
+// Asteroid field drawn with instancing: number of asteroids (none if 0)
+const int asteroid_field_size_g = 1500;
 
-Game::Game(void){
+
+Game::Game(void) : firework_random_(RANDOM_DEFAULT_SEED, FireworkStream){
 
     // Don't do work in the constructor, leave it for the Init() function
 }
@@ -111,11 +114,16 @@ void Game::InitEventHandlers(void){
 
 void Game::SetupResources(void){
 
+    // Files are read in the background while the procedural geometry is
+    // generated; the scene can refer to the resources right away and
+    // each node is drawn once its resources are ready (see MainLoop)
+
     // Load material to be applied to torus
     std::string filename = std::string(MATERIAL_DIRECTORY) + std::string("/three-term_shiny_blue");
-    resman_.LoadResource(Material, "ShinyBlueMaterial", filename.c_str());
+    resman_.LoadResourceAsync(Material, "ShinyBlueMaterial", filename.c_str());
 
-    // Load material for screen-space effect
+    // Load material for screen-space effect; every frame is displayed
+    // with it, so it is loaded before the first frame
     filename = std::string(MATERIAL_DIRECTORY) + std::string("/screen_space");
     resman_.LoadResource(Material, "ScreenSpaceMaterial", filename.c_str());
 
@@ -125,16 +133,24 @@ void Game::SetupResources(void){
     // Create a torus
     resman_.CreateTorus("TorusMesh");
 
+    // Load material and geometry of the asteroid field; asteroids far from
+    // the camera use the coarser levels of the sphere. The sphere's colors
+    // are in [0, 1] and its shader only reads positions and colors, so it
+    // is stored in the compact vertex format
+    filename = std::string(MATERIAL_DIRECTORY) + std::string("/material_instanced");
+    resman_.LoadResourceAsync(Material, "InstancedObjectMaterial", filename.c_str());
+    resman_.CreateSphere("SimpleSphereMesh", 0.8, 30, 15, CompactVertexFormat, 3);
+
 
 	// Load material to be applied to particles
 	filename = std::string(MATERIAL_DIRECTORY) + std::string("/particle");
-	resman_.LoadResource(Material, "ParticleMaterial", filename.c_str());
+	resman_.LoadResourceAsync(Material, "ParticleMaterial", filename.c_str());
 	// Load material to be applied to flamethrower
 	filename = std::string(MATERIAL_DIRECTORY) + std::string("/fire");
-	resman_.LoadResource(Material, "FireMaterial", filename.c_str());
+	resman_.LoadResourceAsync(Material, "FireMaterial", filename.c_str());
 	// Load material to be applied to ring effect
 	filename = std::string(MATERIAL_DIRECTORY) + std::string("/ring");
-	resman_.LoadResource(Material, "RingMaterial", filename.c_str());
+	resman_.LoadResourceAsync(Material, "RingMaterial", filename.c_str());
 	
 	// Create particles for explosion
 	resman_.CreateSphereParticles("SphereParticles");
@@ -145,7 +161,7 @@ void Game::SetupResources(void){
 	
 	////Flame effect texture
 	filename = std::string(MATERIAL_DIRECTORY) + std::string("/flame4x4orig.png");
-	resman_.LoadResource(Texture, "Flame", filename.c_str());
+	resman_.LoadResourceAsync(Texture, "Flame", filename.c_str());
 }
 
 
@@ -185,29 +201,49 @@ void Game::SetupScene(void){
 	game::SceneNode *ring1 = CreateInstance("RingInstance1", "RingParticles", "RingMaterial");
 	ring1->SetBlending(true);
 	ring1->SetScale(glm::vec3(0.0));
+
+    // Create the asteroid field
+    if (asteroid_field_size_g > 0){
+        CreateAsteroidField(asteroid_field_size_g);
+    }
+
+	// Cache handles of the nodes used in the main loop and key handlers
+	torus_[0] = scene_.GetNodeHandle("TorusInstance1");
+	torus_[1] = scene_.GetNodeHandle("TorusInstance2");
+	torus_[2] = scene_.GetNodeHandle("TorusInstance3");
+	torus_[3] = scene_.GetNodeHandle("TorusInstance4");
+	fireworks_[0] = scene_.GetNodeHandle("FireworksInstance1");
+	fireworks_[1] = scene_.GetNodeHandle("FireworksInstance2");
+	fireworks_[2] = scene_.GetNodeHandle("FireworksInstance3");
+	fire_ = scene_.GetNodeHandle("FireInstance1");
+	ring_ = scene_.GetNodeHandle("RingInstance1");
 }
 
 
 void Game::ResetFirework(SceneNode* node, float current)
 {
-	float x = -1 + 2.0 * (float)rand() / RAND_MAX;
-	float y = -1 + 2.0 * (float)rand() / RAND_MAX;
-	float z = 0 + 1.0 * (float)rand() / RAND_MAX;
+	// Random position and momentum; the firework stream gives the same
+	// sequence of fireworks in every run
+	float r[6];
+	firework_random_.Uniform(r, 6);
+	float x = -1 + 2.0 * r[0];
+	float y = -1 + 2.0 * r[1];
+	float z = 0 + 1.0 * r[2];
 	node->SetPosition(glm::vec3(x, y, z));
 	node->SetStart(current);
 	node->SetEnd(current + 2.0);
-	x = -1 + 2.0 * (float)rand() / RAND_MAX;
-	y = -1 + 2.0 * (float)rand() / RAND_MAX;
-	z = 0 + 1.0 * (float)rand() / RAND_MAX;
+	x = -1 + 2.0 * r[3];
+	y = -1 + 2.0 * r[4];
+	z = 0 + 1.0 * r[5];
 	node->SetMomentum(glm::vec3(x, y, z));
 	node->SetColorAtt(glm::vec3(abs(x), abs(y), abs(z)));
 }
 
 void Game::ToggleFireworks(bool state)
 {
-	SceneNode* node1 = scene_.GetNode("FireworksInstance1");
-	SceneNode* node2 = scene_.GetNode("FireworksInstance2");
-	SceneNode* node3 = scene_.GetNode("FireworksInstance3");
+	SceneNode* node1 = scene_.GetNode(fireworks_[0]);
+	SceneNode* node2 = scene_.GetNode(fireworks_[1]);
+	SceneNode* node3 = scene_.GetNode(fireworks_[2]);
 
 	if (!state)
 	{
@@ -224,7 +260,7 @@ void Game::ToggleFireworks(bool state)
 }
 void Game::ToggleFlamethrower(bool state)
 {
-	SceneNode* node = scene_.GetNode("FireInstance1");
+	SceneNode* node = scene_.GetNode(fire_);
 	if (!state)
 	{
 		node->SetScale(glm::vec3(0.0));
@@ -236,7 +272,7 @@ void Game::ToggleFlamethrower(bool state)
 }
 void Game::ToggleRing(bool state)
 {
-	SceneNode* node = scene_.GetNode("RingInstance1");
+	SceneNode* node = scene_.GetNode(ring_);
 	if (!state)
 	{
 		node->SetScale(glm::vec3(0.0));
@@ -251,6 +287,11 @@ void Game::MainLoop(void){
 
     // Loop while the user did not close the window
     while (!glfwWindowShouldClose(window_)){
+        // Create the OpenGL objects of resources loaded in the background
+        resman_.ProcessLoadedResources();
+        // Pick up edits to the shaders
+        resman_.ReloadModifiedMaterials();
+
         // Animate the scene
         if (animating_){
             static double last_time = 0;
@@ -263,19 +304,17 @@ void Game::MainLoop(void){
 
 			float deltaTime = current_time - last_time;
             if (deltaTime > 0.01){
-                //scene_.Update();
+                // Rotate the asteroids; the other nodes are animated below
+                if (asteroid_field_size_g > 0){
+                    scene_.Update();
+                }
 
                 // Animate the torus
 				glm::quat rotation = glm::angleAxis(glm::pi<float>() / 180.0f, glm::vec3(0.0, 1.0, 0.0));
 
-                SceneNode *node = scene_.GetNode("TorusInstance1");
-                node->Rotate(rotation);
-				node = scene_.GetNode("TorusInstance2");
-				node->Rotate(rotation);
-				node = scene_.GetNode("TorusInstance3");
-				node->Rotate(rotation);
-				node = scene_.GetNode("TorusInstance4");
-				node->Rotate(rotation);
+                for (int i = 0; i < 4; i++){
+                    scene_.GetNode(torus_[i])->Rotate(rotation);
+                }
 
 				start1 += deltaTime;
 				start2 += deltaTime;
@@ -283,19 +322,19 @@ void Game::MainLoop(void){
 
 				if (start1 >= 2.0)
 				{
-					SceneNode* node = scene_.GetNode("FireworksInstance1");
+					SceneNode* node = scene_.GetNode(fireworks_[0]);
 					ResetFirework(node, current_time);
 					start1 = 0.0;
 				}
 				if (start2 >= 2.0)
 				{
-					SceneNode* node = scene_.GetNode("FireworksInstance2");
+					SceneNode* node = scene_.GetNode(fireworks_[1]);
 					ResetFirework(node, current_time);
 					start2 = 0.0;
 				}
 				if (start3 >= 2.0)
 				{
-					SceneNode* node = scene_.GetNode("FireworksInstance3");
+					SceneNode* node = scene_.GetNode(fireworks_[2]);
 					ResetFirework(node, current_time);
 					start3 = 0.0;
 				}
@@ -319,7 +358,7 @@ void Game::MainLoop(void){
 
         // Process the texture with a screen-space effect and display
         // the texture
-        scene_.DisplayTexture(resman_.GetResource("ScreenSpaceMaterial")->GetResource(), effect_num);
+        scene_.DisplayTexture(resman_.GetResource("ScreenSpaceMaterial"), effect_num);
 
         // Push buffer drawn in the background onto the display
         glfwSwapBuffers(window_);
@@ -463,22 +502,31 @@ Asteroid *Game::CreateAsteroidInstance(std::string entity_name, std::string obje
 
 void Game::CreateAsteroidField(int num_asteroids){
 
-    // Create a number of asteroid instances
-    for (int i = 0; i < num_asteroids; i++){
-        // Create instance name
-        std::stringstream ss;
-        ss << i;
-        std::string index = ss.str();
-        std::string name = "AsteroidInstance" + index;
+    // Get resources
+    Resource *geom = resman_.GetResource("SimpleSphereMesh");
+    if (!geom){
+        throw(GameException(std::string("Could not find resource \"SimpleSphereMesh\"")));
+    }
 
-        // Create asteroid instance
-        Asteroid *ast = CreateAsteroidInstance(name, "SimpleSphereMesh", "ObjectMaterial");
+    Resource *mat = resman_.GetResource("InstancedObjectMaterial");
+    if (!mat){
+        throw(GameException(std::string("Could not find resource \"InstancedObjectMaterial\"")));
+    }
+
+    // All asteroids are instances of a single node, drawn with one call
+    AsteroidField *field = new AsteroidField("AsteroidField", geom, mat);
+    scene_.AddNode(field);
 
+    // Create a number of asteroid instances, the same field in every run
+    Random random(RANDOM_DEFAULT_SEED, AsteroidStream);
+    for (int i = 0; i < num_asteroids; i++){
         // Set attributes of asteroid: random position, orientation, and
         // angular momentum
-        ast->SetPosition(glm::vec3(-300.0 + 600.0*((float) rand() / RAND_MAX), -300.0 + 600.0*((float) rand() / RAND_MAX), 600.0*((float) rand() / RAND_MAX)));
-        ast->SetOrientation(glm::normalize(glm::angleAxis(glm::pi<float>()*((float) rand() / RAND_MAX), glm::vec3(((float) rand() / RAND_MAX), ((float) rand() / RAND_MAX), ((float) rand() / RAND_MAX)))));
-        ast->SetAngM(glm::normalize(glm::angleAxis(0.05f*glm::pi<float>()*((float) rand() / RAND_MAX), glm::vec3(((float) rand() / RAND_MAX), ((float) rand() / RAND_MAX), ((float) rand() / RAND_MAX)))));
+        float r[11];
+        random.Uniform(r, 11);
+        field->AddAsteroid(glm::vec3(-300.0 + 600.0*r[0], -300.0 + 600.0*r[1], 600.0*r[2]),
+                           glm::normalize(glm::angleAxis(glm::pi<float>()*r[3], glm::vec3(r[4], r[5], r[6]))),
+                           glm::normalize(glm::angleAxis(0.05f*glm::pi<float>()*r[7], glm::vec3(r[8], r[9], r[10]))));
     }
 }
 
@@ -11,6 +11,7 @@
 #include "resource_manager.h"
 #include "camera.h"
 #include "asteroid.h"
+#include "random.h"
 
 namespace game {
 
@@ -60,6 +61,16 @@ namespace game {
             // Flag to turn animation on/off
             bool animating_;
 
+            // Handles of the nodes accessed every frame and by the key
+            // handlers, looked up once when the scene is set up
+            NodeHandle torus_[4];
+            NodeHandle fireworks_[3];
+            NodeHandle fire_;
+            NodeHandle ring_;
+
+            // Random numbers for the fireworks
+            Random firework_random_;
+
             // Methods to initialize the game
             void InitWindow(void);
             void InitView(void);
@@ -76,7 +87,9 @@ namespace game {
             // Asteroid field
             // Create instance of one asteroid
             Asteroid *CreateAsteroidInstance(std::string entity_name, std::string object_name, std::string material_name);
-            // Create entire random asteroid field
+            // Create entire random asteroid field, drawn with instancing
+            // Uses the "SimpleSphereMesh" geometry and the
+            // "InstancedObjectMaterial" material (material_instanced)
             void CreateAsteroidField(int num_asteroids = 1500);
 
             // Create an instance of an object stored in the resource manager
@@ -0,0 +1,417 @@
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/constants.hpp>
+
+#include "geometry_generator.h"
+#include "job_system.h"
+#include "mesh_optimizer.h"
+#include "random.h"
+
+// Number of attributes for vertices and faces
+#define GENERATED_VERTEX_ATT 11
+#define GENERATED_FACE_ATT 3
+
+// Number of rows of samples generated by one job
+#define GENERATOR_ROW_CHUNK_SIZE 8
+// Number of particles generated by one job
+#define GENERATOR_PARTICLE_CHUNK_SIZE 2048
+
+namespace game {
+
+// Kinds of generated geometry, part of the cache key
+enum GeneratedGeometryKind {
+    TorusGeometry,
+    SphereGeometry,
+    SphereParticlesGeometry,
+    FireParticlesGeometry,
+    RingParticlesGeometry
+};
+
+
+bool GeometryGenerator::Key::operator==(const Key &other) const {
+
+    return (kind == other.kind) && (f[0] == other.f[0]) && (f[1] == other.f[1]) && (i[0] == other.i[0]) && (i[1] == other.i[1]);
+}
+
+
+size_t GeometryGenerator::KeyHash::operator()(const Key &key) const {
+
+    // Mix the fields with large odd multipliers
+    unsigned int bits[2];
+    std::memcpy(bits, key.f, sizeof(bits));
+    size_t h = (size_t) (unsigned int) key.kind * 0x9E3779B1u;
+    h ^= (size_t) bits[0] * 0x85EBCA77u + (h << 6) + (h >> 2);
+    h ^= (size_t) bits[1] * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+    h ^= (size_t) (unsigned int) key.i[0] * 0x27D4EB2Fu + (h << 6) + (h >> 2);
+    h ^= (size_t) (unsigned int) key.i[1] * 0x165667B1u + (h << 6) + (h >> 2);
+    return h;
+}
+
+
+GeometryGenerator::Key GeometryGenerator::MakeKey(int kind, float f0, float f1, int i0, int i1){
+
+    Key key;
+    key.kind = kind;
+    key.f[0] = f0;
+    key.f[1] = f1;
+    key.i[0] = i0;
+    key.i[1] = i1;
+    return key;
+}
+
+
+// Reorder a generated mesh for the vertex cache and record the change in
+// the average number of vertex shader runs per triangle
+static void OptimizeGeneratedMesh(GeneratedGeometry &geometry){
+
+    GLsizei num_indices = (GLsizei) geometry.index.size();
+    if (num_indices == 0){
+        geometry.acmr_before = geometry.acmr_after = 0.0;
+        return;
+    }
+    geometry.acmr_before = ComputeACMR(&geometry.index[0], num_indices, geometry.num_vertices);
+    // Generated meshes are convex or nearly so, so overdraw order does
+    // not matter
+    geometry.num_vertices = OptimizeMesh(&geometry.vertex[0], GENERATED_VERTEX_ATT, geometry.num_vertices, &geometry.index[0], num_indices, false);
+    geometry.vertex.resize((size_t) geometry.num_vertices * GENERATED_VERTEX_ATT);
+    geometry.acmr_after = ComputeACMR(&geometry.index[0], num_indices, geometry.num_vertices);
+}
+
+
+// Write the attributes of one particle
+static void SetParticle(GLfloat *particle, const glm::vec3 &position, const glm::vec3 &normal, const glm::vec3 &color){
+
+    for (int k = 0; k < 3; k++){
+        particle[k] = position[k];
+        particle[k + 3] = normal[k];
+        particle[k + 6] = color[k];
+    }
+}
+
+
+GeometryGenerator::GeometryGenerator(uint64_t seed){
+
+    seed_ = seed;
+}
+
+
+GeometryGenerator::~GeometryGenerator(){
+}
+
+
+void GeometryGenerator::Clear(void){
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_.clear();
+}
+
+
+std::shared_ptr<const GeneratedGeometry> GeometryGenerator::Find(const Key &key){
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<Key, std::shared_ptr<const GeneratedGeometry>, KeyHash>::const_iterator it = cache_.find(key);
+    if (it == cache_.end()){
+        return std::shared_ptr<const GeneratedGeometry>();
+    }
+    return it->second;
+}
+
+
+std::shared_ptr<const GeneratedGeometry> GeometryGenerator::Store(const Key &key, std::shared_ptr<const GeneratedGeometry> geometry){
+
+    // If another thread generated the same geometry meanwhile, keep the
+    // first one so that all users share it
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.insert(std::make_pair(key, geometry)).first->second;
+}
+
+
+std::shared_ptr<const GeneratedGeometry> GeometryGenerator::GenerateTorus(float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples){
+
+    Key key = MakeKey(TorusGeometry, loop_radius, circle_radius, num_loop_samples, num_circle_samples);
+    std::shared_ptr<const GeneratedGeometry> cached = Find(key);
+    if (cached){
+        return cached;
+    }
+
+    // The torus is built from a large loop with small circles around the
+    // loop
+    std::shared_ptr<GeneratedGeometry> geometry = std::make_shared<GeneratedGeometry>();
+    geometry->num_vertices = num_loop_samples*num_circle_samples;
+    geometry->vertex.resize((size_t) geometry->num_vertices * GENERATED_VERTEX_ATT);
+    geometry->index.resize((size_t) num_loop_samples*num_circle_samples*2 * GENERATED_FACE_ATT);
+    // The torus is contained in the sphere that touches the outer edge of
+    // the loop
+    geometry->center = glm::vec3(0.0, 0.0, 0.0);
+    geometry->radius = loop_radius + circle_radius;
+
+    // Sines and cosines of the loop samples (angle theta) and circle
+    // samples (angle phi)
+    std::vector<float> cos_theta(num_loop_samples), sin_theta(num_loop_samples);
+    for (int i = 0; i < num_loop_samples; i++){
+        float theta = 2.0*glm::pi<GLfloat>()*i/num_loop_samples;
+        cos_theta[i] = cos(theta);
+        sin_theta[i] = sin(theta);
+    }
+    std::vector<float> cos_phi(num_circle_samples), sin_phi(num_circle_samples);
+    for (int j = 0; j < num_circle_samples; j++){
+        float phi = 2.0*glm::pi<GLfloat>()*j/num_circle_samples;
+        cos_phi[j] = cos(phi);
+        sin_phi[j] = sin(phi);
+    }
+
+    // Each job fills the vertices of some small circles and the triangles
+    // joining them to the next circles
+    GLfloat *vertex = &geometry->vertex[0];
+    GLuint *face = &geometry->index[0];
+    JobSystem::GetInstance().ParallelFor(num_loop_samples, GENERATOR_ROW_CHUNK_SIZE, [&](int begin, int end){
+        for (int i = begin; i < end; i++){ // large loop
+            glm::vec3 loop_center(loop_radius*cos_theta[i], loop_radius*sin_theta[i], 0); // centre of a small circle
+            for (int j = 0; j < num_circle_samples; j++){ // small circle
+                // Define position, normal and color of vertex
+                glm::vec3 vertex_normal(cos_theta[i]*cos_phi[j], sin_theta[i]*cos_phi[j], sin_phi[j]);
+                glm::vec3 vertex_position = loop_center + vertex_normal*circle_radius;
+                glm::vec3 vertex_color(1.0 - ((float) i / (float) num_loop_samples),
+                                       (float) i / (float) num_loop_samples,
+                                       (float) j / (float) num_circle_samples);
+                glm::vec2 vertex_coord((float) i / (float) num_loop_samples,
+                                       (float) j / (float) num_circle_samples);
+
+                // Add vectors to the data buffer
+                GLfloat *att = vertex + (size_t) (i*num_circle_samples+j)*GENERATED_VERTEX_ATT;
+                for (int k = 0; k < 3; k++){
+                    att[k] = vertex_position[k];
+                    att[k + 3] = vertex_normal[k];
+                    att[k + 6] = vertex_color[k];
+                }
+                att[9] = vertex_coord[0];
+                att[10] = vertex_coord[1];
+
+                // Two triangles per quad
+                GLuint t[6] = {
+                    (GLuint) (((i + 1) % num_loop_samples)*num_circle_samples + j),
+                    (GLuint) (i*num_circle_samples + ((j + 1) % num_circle_samples)),
+                    (GLuint) (i*num_circle_samples + j),
+                    (GLuint) (((i + 1) % num_loop_samples)*num_circle_samples + j),
+                    (GLuint) (((i + 1) % num_loop_samples)*num_circle_samples + ((j + 1) % num_circle_samples)),
+                    (GLuint) (i*num_circle_samples + ((j + 1) % num_circle_samples))};
+                std::memcpy(face + (size_t) (i*num_circle_samples+j)*GENERATED_FACE_ATT*2, t, sizeof(t));
+            }
+        }
+    });
+
+    OptimizeGeneratedMesh(*geometry);
+    return Store(key, geometry);
+}
+
+
+std::shared_ptr<const GeneratedGeometry> GeometryGenerator::GenerateSphere(float radius, int num_samples_theta, int num_samples_phi){
+
+    Key key = MakeKey(SphereGeometry, radius, 0.0, num_samples_theta, num_samples_phi);
+    std::shared_ptr<const GeneratedGeometry> cached = Find(key);
+    if (cached){
+        return cached;
+    }
+
+    // Sphere using a well-known parameterization
+    std::shared_ptr<GeneratedGeometry> geometry = std::make_shared<GeneratedGeometry>();
+    geometry->num_vertices = num_samples_theta*num_samples_phi;
+    geometry->vertex.resize((size_t) geometry->num_vertices * GENERATED_VERTEX_ATT);
+    geometry->index.resize((size_t) num_samples_theta*(num_samples_phi-1)*2 * GENERATED_FACE_ATT);
+    geometry->center = glm::vec3(0.0, 0.0, 0.0);
+    geometry->radius = radius;
+
+    // Sines and cosines of the sample angles
+    std::vector<float> cos_theta(num_samples_theta), sin_theta(num_samples_theta);
+    for (int i = 0; i < num_samples_theta; i++){
+        float theta = 2.0*glm::pi<GLfloat>()*i/(num_samples_theta-1);
+        cos_theta[i] = cos(theta);
+        sin_theta[i] = sin(theta);
+    }
+    std::vector<float> cos_phi(num_samples_phi), sin_phi(num_samples_phi);
+    for (int j = 0; j < num_samples_phi; j++){
+        float phi = glm::pi<GLfloat>()*j/(num_samples_phi-1);
+        cos_phi[j] = cos(phi);
+        sin_phi[j] = sin(phi);
+    }
+
+    // Each job fills some columns of vertices (fixed theta) and the
+    // triangles joining them to the next columns
+    GLfloat *vertex = &geometry->vertex[0];
+    GLuint *face = &geometry->index[0];
+    JobSystem::GetInstance().ParallelFor(num_samples_theta, GENERATOR_ROW_CHUNK_SIZE, [&](int begin, int end){
+        for (int i = begin; i < end; i++){
+            for (int j = 0; j < num_samples_phi; j++){
+                // Define position, normal and color of vertex
+                // We need z = -cos(phi) to make sure that the z coordinate
+                // runs from -1 to 1 as phi runs from 0 to pi
+                glm::vec3 vertex_normal(cos_theta[i]*sin_phi[j], sin_theta[i]*sin_phi[j], -cos_phi[j]);
+                glm::vec3 vertex_position = vertex_normal*radius;
+                glm::vec3 vertex_color(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi), ((float)j)/((float)num_samples_phi));
+                glm::vec2 vertex_coord(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi));
+
+                // Add vectors to the data buffer
+                GLfloat *att = vertex + (size_t) (i*num_samples_phi+j)*GENERATED_VERTEX_ATT;
+                for (int k = 0; k < 3; k++){
+                    att[k] = vertex_position[k];
+                    att[k + 3] = vertex_normal[k];
+                    att[k + 6] = vertex_color[k];
+                }
+                att[9] = vertex_coord[0];
+                att[10] = vertex_coord[1];
+            }
+
+            for (int j = 0; j < (num_samples_phi-1); j++){
+                // Two triangles per quad
+                GLuint t[6] = {
+                    (GLuint) (((i + 1) % num_samples_theta)*num_samples_phi + j),
+                    (GLuint) (i*num_samples_phi + (j + 1)),
+                    (GLuint) (i*num_samples_phi + j),
+                    (GLuint) (((i + 1) % num_samples_theta)*num_samples_phi + j),
+                    (GLuint) (((i + 1) % num_samples_theta)*num_samples_phi + (j + 1)),
+                    (GLuint) (i*num_samples_phi + (j + 1))};
+                std::memcpy(face + (size_t) (i*(num_samples_phi-1)+j)*GENERATED_FACE_ATT*2, t, sizeof(t));
+            }
+        }
+    });
+
+    OptimizeGeneratedMesh(*geometry);
+    return Store(key, geometry);
+}
+
+
+std::shared_ptr<const GeneratedGeometry> GeometryGenerator::GenerateSphereParticles(int num_particles){
+
+    Key key = MakeKey(SphereParticlesGeometry, 0.0, 0.0, num_particles, 0);
+    std::shared_ptr<const GeneratedGeometry> cached = Find(key);
+    if (cached){
+        return cached;
+    }
+
+    // Points sampled on a sphere, allowed to deviate from the sphere along
+    // the normal (change of radius)
+    std::shared_ptr<GeneratedGeometry> geometry = std::make_shared<GeneratedGeometry>();
+    geometry->num_vertices = num_particles;
+    geometry->vertex.resize((size_t) num_particles * GENERATED_VERTEX_ATT, 0.0);
+    geometry->radius = -1.0;
+    geometry->acmr_before = geometry->acmr_after = 0.0;
+
+    const float trad = 0.0; // Defines the starting point of the particles along the normal
+    const float maxspray = 0.5; // This is how much we allow the points to deviate from the sphere
+
+    // Particle i takes its random numbers from block i of the stream
+    const Random random(seed_, SphereParticleStream);
+    GLfloat *particle = &geometry->vertex[0];
+    JobSystem::GetInstance().ParallelFor(num_particles, GENERATOR_PARTICLE_CHUNK_SIZE, [&](int begin, int end){
+        for (int i = begin; i < end; i++){
+            float r[4];
+            random.UniformBlock(i, r);
+
+            // Use r[0] and r[1] to pick a direction, and r[2] to define how
+            // much we can deviate from the surface of the sphere (change of
+            // radius)
+            float spray = maxspray * pow(r[2], (float)(1.0 / 3.0)); // Cubic root
+            glm::vec3 normal = spray * Random::SphereFromUniform(r[0], r[1]);
+            glm::vec3 position = normal*trad;
+            glm::vec3 color(i / (float)num_particles, 0.0, 1.0 - (i / (float)num_particles));
+            SetParticle(particle + (size_t) i*GENERATED_VERTEX_ATT, position, normal, color);
+        }
+    });
+
+    return Store(key, geometry);
+}
+
+
+std::shared_ptr<const GeneratedGeometry> GeometryGenerator::GenerateFireParticles(int num_particles){
+
+    Key key = MakeKey(FireParticlesGeometry, 0.0, 0.0, num_particles, 0);
+    std::shared_ptr<const GeneratedGeometry> cached = Find(key);
+    if (cached){
+        return cached;
+    }
+
+    // Points on a narrow cap of a sphere, each with its own time offset
+    std::shared_ptr<GeneratedGeometry> geometry = std::make_shared<GeneratedGeometry>();
+    geometry->num_vertices = num_particles;
+    geometry->vertex.resize((size_t) num_particles * GENERATED_VERTEX_ATT, 0.0);
+    geometry->radius = -1.0;
+    geometry->acmr_before = geometry->acmr_after = 0.0;
+
+    const float trad = 0.2; // Defines the starting point of the particles along the normal
+    const float maxspray = 0.5; // This is how much we allow the points to deviate from the sphere
+    const float spread = 1.0 / 32.0f; // Fraction of the sphere height covered by the cap
+
+    const Random random(seed_, FireParticleStream);
+    GLfloat *particle = &geometry->vertex[0];
+    JobSystem::GetInstance().ParallelFor(num_particles, GENERATOR_PARTICLE_CHUNK_SIZE, [&](int begin, int end){
+        for (int i = begin; i < end; i++){
+            float r[4];
+            random.UniformBlock(i, r);
+
+            // Direction within the cap around -z, and time offset against
+            // other particles
+            glm::vec3 normal = maxspray * Random::SphereFromUniform(r[0], r[1] * spread * 0.5f);
+            glm::vec3 position = normal*trad;
+            float offset = 4.0 * r[2];
+            // The time offset is encoded in the green channel of the color
+            glm::vec3 color(i / (float)num_particles, offset, 1.0 - (i / (float)num_particles));
+            SetParticle(particle + (size_t) i*GENERATED_VERTEX_ATT, position, normal, color);
+        }
+    });
+
+    return Store(key, geometry);
+}
+
+
+std::shared_ptr<const GeneratedGeometry> GeometryGenerator::GenerateRingParticles(int num_particles){
+
+    Key key = MakeKey(RingParticlesGeometry, 0.0, 0.0, num_particles, 0);
+    std::shared_ptr<const GeneratedGeometry> cached = Find(key);
+    if (cached){
+        return cached;
+    }
+
+    // Two parts: a small explosion, then the ring in the xy plane
+    std::shared_ptr<GeneratedGeometry> geometry = std::make_shared<GeneratedGeometry>();
+    geometry->num_vertices = num_particles;
+    geometry->vertex.resize((size_t) num_particles * GENERATED_VERTEX_ATT, 0.0);
+    geometry->radius = -1.0;
+    geometry->acmr_before = geometry->acmr_after = 0.0;
+
+    const float trad = 0.05; // Defines the starting point of the particles along the normal
+    const float maxspray = 0.5; // This is how much we allow the points to deviate from the sphere
+
+    const int num_explosion_particles = num_particles / 100;
+    const int num_ring_particles = num_particles - num_explosion_particles;
+
+    const Random random(seed_, RingParticleStream);
+    GLfloat *particle = &geometry->vertex[0];
+    JobSystem::GetInstance().ParallelFor(num_particles, GENERATOR_PARTICLE_CHUNK_SIZE, [&](int begin, int end){
+        for (int i = begin; i < end; i++){
+            float r[4];
+            random.UniformBlock(i, r);
+
+            glm::vec3 normal, color;
+            if (i < num_explosion_particles){
+                // Explosion: direction over the whole sphere, deviating from
+                // the sphere as for the sphere particles
+                float spray = maxspray * pow(r[2], (float)(1.0 / 3.0)); // Cubic root
+                normal = spray * Random::SphereFromUniform(r[0], r[1]);
+                color = glm::vec3(i / (float)num_explosion_particles, spray / maxspray, 1.0 - (i / (float)num_explosion_particles)); // We can use the color for debug, if needed
+            } else {
+                // Ring: angle in the xy plane, and spread around the radius
+                int j = i - num_explosion_particles;
+                float theta = r[0] * 2.0*glm::pi<float>();
+                float spray = maxspray * (0.9 + r[2] * 0.5);
+                normal = glm::vec3(spray*cos(theta), spray*sin(theta), 0.0);
+                color = glm::vec3(j / (float)num_ring_particles, spray / maxspray, 1.0 - (j / (float)num_ring_particles)); // We can use the color for debug, if needed
+            }
+            glm::vec3 position = normal*trad;
+            SetParticle(particle + (size_t) i*GENERATED_VERTEX_ATT, position, normal, color);
+        }
+    });
+
+    return Store(key, geometry);
+}
+
+} // namespace game
@@ -0,0 +1,87 @@
+#ifndef GEOMETRY_GENERATOR_H_
+#define GEOMETRY_GENERATOR_H_
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "random.h"
+
+namespace game {
+
+    // Geometry built on the CPU, ready to be uploaded
+    struct GeneratedGeometry {
+        std::vector<GLfloat> vertex; // 11 floats per vertex: position, normal, color, texture coordinates
+        std::vector<GLuint> index; // Triangle indices; empty for point sets
+        GLsizei num_vertices;
+        // Bounding sphere; a negative radius means no bounds
+        glm::vec3 center;
+        float radius;
+        // Vertex cache efficiency before and after optimizing a mesh
+        float acmr_before;
+        float acmr_after;
+    };
+
+    // Builds the procedural geometry of the game without touching OpenGL,
+    // so that only the upload is left to the thread that owns the context
+    // Meshes are generated in parallel, one chunk of rows per job, with
+    // the sines and cosines of the sample angles computed once per row and
+    // column rather than per vertex, and are optimized for the vertex
+    // cache. The normals of the torus and sphere are the exact normals of
+    // the surfaces, so they are not computed from the faces with
+    // ComputeVertexNormals. Results are kept by parameter values, so asking twice for the
+    // same geometry does not generate it again
+    // Particle sets are generated in parallel as well: each particle draws
+    // from its own block of a counter-based random stream, so the result
+    // only depends on the seed
+    class GeometryGenerator {
+
+        public:
+            GeometryGenerator(uint64_t seed = RANDOM_DEFAULT_SEED);
+            ~GeometryGenerator();
+
+            // Parameters are as for the ResourceManager methods of the same
+            // names
+            std::shared_ptr<const GeneratedGeometry> GenerateTorus(float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples);
+            std::shared_ptr<const GeneratedGeometry> GenerateSphere(float radius, int num_samples_theta, int num_samples_phi);
+            std::shared_ptr<const GeneratedGeometry> GenerateSphereParticles(int num_particles);
+            std::shared_ptr<const GeneratedGeometry> GenerateFireParticles(int num_particles);
+            std::shared_ptr<const GeneratedGeometry> GenerateRingParticles(int num_particles);
+
+            // Forget the generated geometry (geometry still referenced
+            // elsewhere stays alive)
+            void Clear(void);
+
+        private:
+            // Kind of geometry and parameter values
+            struct Key {
+                int kind;
+                float f[2];
+                int i[2];
+
+                bool operator==(const Key &other) const;
+            };
+            struct KeyHash {
+                size_t operator()(const Key &key) const;
+            };
+
+            uint64_t seed_; // Seed of the random particle positions
+            std::unordered_map<Key, std::shared_ptr<const GeneratedGeometry>, KeyHash> cache_;
+            std::mutex mutex_;
+
+            static Key MakeKey(int kind, float f0, float f1, int i0, int i1);
+            // Return the cached geometry for key, or null
+            std::shared_ptr<const GeneratedGeometry> Find(const Key &key);
+            // Cache geometry and return the cached geometry for key
+            std::shared_ptr<const GeneratedGeometry> Store(const Key &key, std::shared_ptr<const GeneratedGeometry> geometry);
+
+    }; // class GeometryGenerator
+
+} // namespace game
+
+#endif // GEOMETRY_GENERATOR_H_
@@ -0,0 +1,27 @@
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Initial value of a 64-bit FNV-1a hash
+#define HASH_SEED 0xcbf29ce484222325ull
+
+namespace game {
+
+    // 64-bit FNV-1a hash of a block of bytes; pass the result of a previous
+    // call as seed to hash several blocks as one
+    inline uint64_t HashBytes(const void *data, size_t size, uint64_t seed = HASH_SEED){
+
+        const unsigned char *byte = (const unsigned char *) data;
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; i++){
+            hash ^= byte[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+} // namespace game
+
+#endif // HASH_H_
@@ -0,0 +1,289 @@
+#include <stdexcept>
+#include <atomic>
+
+#include "instanced_node.h"
+#include "job_system.h"
+
+// Number of instances whose level of detail is selected by one job
+#define LOD_CHUNK_SIZE 4096
+
+namespace game {
+
+InstancedNode::InstancedNode(const std::string name, const Resource *geometry, const Resource *material, const Resource *texture) : SceneNode(name, geometry, material, texture) {
+
+    if (geometry->GetType() != Mesh){
+        throw(std::invalid_argument(std::string("Instanced geometry must be a mesh")));
+    }
+
+    // The vertex arrays are set up once the geometry is loaded
+    geometry_ = geometry;
+    if (geometry->IsReady()){
+        SetupLevels();
+    }
+
+    instances_dirty_ = false;
+    bounds_dirty_ = true;
+}
+
+
+void InstancedNode::SetupLevels(void){
+
+    // For each level of detail, set up a vertex array with the geometry
+    // layout plus one buffer per instance attribute, advanced once per
+    // instance
+    for (int l = 0; l < geometry_->GetNumLevelsOfDetail(); l++){
+        LevelBatch batch;
+        batch.geometry = geometry_->GetLevelOfDetail(l);
+        batch.num_instances = 0;
+
+        glGenVertexArrays(1, &batch.vertex_array);
+        glBindVertexArray(batch.vertex_array);
+
+        glBindBuffer(GL_ARRAY_BUFFER, batch.geometry->GetArrayBuffer());
+        SetupVertexAttributes(GetVertexFormat(batch.geometry->GetVertexFormat()));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.geometry->GetElementArrayBuffer());
+
+        glGenBuffers(3, batch.instance_buffer);
+
+        glBindBuffer(GL_ARRAY_BUFFER, batch.instance_buffer[0]);
+        glVertexAttribPointer(INSTANCE_POSITION_ATTRIBUTE_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(INSTANCE_POSITION_ATTRIBUTE_LOCATION);
+        glVertexAttribDivisor(INSTANCE_POSITION_ATTRIBUTE_LOCATION, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, batch.instance_buffer[1]);
+        glVertexAttribPointer(INSTANCE_ORIENTATION_ATTRIBUTE_LOCATION, 4, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(INSTANCE_ORIENTATION_ATTRIBUTE_LOCATION);
+        glVertexAttribDivisor(INSTANCE_ORIENTATION_ATTRIBUTE_LOCATION, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, batch.instance_buffer[2]);
+        glVertexAttribPointer(INSTANCE_SCALE_ATTRIBUTE_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(INSTANCE_SCALE_ATTRIBUTE_LOCATION);
+        glVertexAttribDivisor(INSTANCE_SCALE_ATTRIBUTE_LOCATION, 1);
+
+        level_.push_back(batch);
+    }
+
+    glBindVertexArray(0);
+
+}
+
+
+InstancedNode::~InstancedNode(){
+
+    for (unsigned int l = 0; l < level_.size(); l++){
+        glDeleteBuffers(3, level_[l].instance_buffer);
+        glDeleteVertexArrays(1, &level_[l].vertex_array);
+    }
+}
+
+
+int InstancedNode::AddInstance(glm::vec3 position, glm::quat orientation, glm::vec3 scale){
+
+    instance_position_.push_back(position);
+    instance_orientation_.push_back(orientation);
+    instance_scale_.push_back(scale);
+    instance_level_.push_back(0);
+    InvalidateInstances();
+
+    return (int) instance_position_.size() - 1;
+}
+
+
+int InstancedNode::GetNumInstances(void) const {
+
+    return (int) instance_position_.size();
+}
+
+
+glm::vec3 InstancedNode::GetInstancePosition(int index) const {
+
+    return instance_position_[index];
+}
+
+
+glm::quat InstancedNode::GetInstanceOrientation(int index) const {
+
+    return instance_orientation_[index];
+}
+
+
+glm::vec3 InstancedNode::GetInstanceScale(int index) const {
+
+    return instance_scale_[index];
+}
+
+
+void InstancedNode::SetInstancePosition(int index, glm::vec3 position){
+
+    instance_position_[index] = position;
+    InvalidateInstances();
+}
+
+
+void InstancedNode::SetInstanceOrientation(int index, glm::quat orientation){
+
+    instance_orientation_[index] = orientation;
+    InvalidateInstances(false);
+}
+
+
+void InstancedNode::SetInstanceScale(int index, glm::vec3 scale){
+
+    instance_scale_[index] = scale;
+    InvalidateInstances();
+}
+
+
+bool InstancedNode::GetWorldBounds(glm::vec3 &center, float &radius) const {
+
+    int num_instances = (int) instance_position_.size();
+    if ((num_instances == 0) || !geometry_->HasBounds()){
+        return false;
+    }
+
+    if (bounds_dirty_){
+        // Center the sphere on the box around the instance positions
+        glm::vec3 low = instance_position_[0];
+        glm::vec3 high = instance_position_[0];
+        for (int i = 1; i < num_instances; i++){
+            low = glm::min(low, instance_position_[i]);
+            high = glm::max(high, instance_position_[i]);
+        }
+        bounds_center_ = 0.5f*(low + high);
+
+        // Any orientation of an instance stays within the geometry's
+        // sphere grown to contain the origin, scaled by the instance
+        float geometry_radius = glm::length(geometry_->GetBoundingCenter()) + geometry_->GetBoundingRadius();
+        bounds_radius_ = 0.0;
+        for (int i = 0; i < num_instances; i++){
+            glm::vec3 scale = glm::abs(instance_scale_[i]);
+            float instance_radius = geometry_radius * glm::max(scale.x, glm::max(scale.y, scale.z));
+            bounds_radius_ = glm::max(bounds_radius_, glm::length(instance_position_[i] - bounds_center_) + instance_radius);
+        }
+        bounds_dirty_ = false;
+    }
+
+    // Transform the sphere by the world matrix, as for other nodes
+    center = glm::vec3(GetWorldMatrix() * glm::vec4(bounds_center_, 1.0));
+    glm::vec3 node_scale = glm::abs(GetScale());
+    radius = bounds_radius_ * glm::max(node_scale.x, glm::max(node_scale.y, node_scale.z));
+    return true;
+}
+
+
+void InstancedNode::InvalidateInstances(bool bounds){
+
+    instances_dirty_ = true;
+    if (bounds){
+        bounds_dirty_ = true;
+    }
+}
+
+
+void InstancedNode::SelectLevelOfDetail(const Camera *camera){
+
+    int num_levels = (int) level_.size();
+    int num_instances = (int) instance_position_.size();
+    if ((num_levels <= 1) || (num_instances == 0) || !level_[0].geometry->HasBounds()){
+        return;
+    }
+
+    // Bounding sphere of an instance: the geometry's sphere around the
+    // instance position, scaled by the node and instance scales
+    const glm::mat4 &world = GetWorldMatrix();
+    glm::vec3 node_scale = glm::abs(GetScale());
+    float radius = level_[0].geometry->GetBoundingRadius() * glm::max(node_scale.x, glm::max(node_scale.y, node_scale.z));
+
+    // Levels only change when instances cross a switch distance; the
+    // instances are regrouped by level only then
+    std::atomic<bool> changed(false);
+    JobSystem::GetInstance().ParallelFor(num_instances, LOD_CHUNK_SIZE, [&](int begin, int end){
+        bool chunk_changed = false;
+        for (int i = begin; i < end; i++){
+            glm::vec3 center = glm::vec3(world * glm::vec4(instance_position_[i], 1.0));
+            glm::vec3 scale = glm::abs(instance_scale_[i]);
+            float projected = camera->GetProjectedRadius(center, radius * glm::max(scale.x, glm::max(scale.y, scale.z)));
+            int level = ChooseLevelOfDetail(projected, instance_level_[i], num_levels);
+            if (level != instance_level_[i]){
+                instance_level_[i] = (unsigned char) level;
+                chunk_changed = true;
+            }
+        }
+        if (chunk_changed){
+            changed = true;
+        }
+    });
+    if (changed){
+        InvalidateInstances(false);
+    }
+}
+
+
+void InstancedNode::UploadLevel(LevelBatch &batch, const glm::vec3 *position, const glm::quat *orientation, const glm::vec3 *scale, GLsizei num_instances){
+
+    // Respecifying the whole buffer lets the driver orphan the storage
+    // still in use by the previous frame
+    batch.num_instances = num_instances;
+    if (num_instances == 0){
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, batch.instance_buffer[0]);
+    glBufferData(GL_ARRAY_BUFFER, num_instances * sizeof(glm::vec3), position, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.instance_buffer[1]);
+    glBufferData(GL_ARRAY_BUFFER, num_instances * sizeof(glm::quat), orientation, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.instance_buffer[2]);
+    glBufferData(GL_ARRAY_BUFFER, num_instances * sizeof(glm::vec3), scale, GL_DYNAMIC_DRAW);
+}
+
+
+void InstancedNode::DrawGeometry(RenderState *state){
+
+    GLsizei num_instances = (GLsizei) instance_position_.size();
+    if (num_instances == 0){
+        return;
+    }
+
+    // Set up the vertex arrays on the first draw after the geometry is
+    // loaded; setting up leaves no vertex array bound
+    if (level_.empty()){
+        SetupLevels();
+        state->BindVertexArray(0);
+        instances_dirty_ = true;
+    }
+
+    // Upload modified instance attributes
+    if (instances_dirty_){
+        if (level_.size() == 1){
+            UploadLevel(level_[0], &instance_position_[0], &instance_orientation_[0], &instance_scale_[0], num_instances);
+        } else {
+            // Group the instances by level of detail
+            batch_position_.resize(num_instances);
+            batch_orientation_.resize(num_instances);
+            batch_scale_.resize(num_instances);
+            int next = 0;
+            for (unsigned int l = 0; l < level_.size(); l++){
+                int first = next;
+                for (int i = 0; i < num_instances; i++){
+                    if (instance_level_[i] == l){
+                        batch_position_[next] = instance_position_[i];
+                        batch_orientation_[next] = instance_orientation_[i];
+                        batch_scale_[next] = instance_scale_[i];
+                        next++;
+                    }
+                }
+                UploadLevel(level_[l], &batch_position_[first], &batch_orientation_[first], &batch_scale_[first], next - first);
+            }
+        }
+        instances_dirty_ = false;
+    }
+
+    // Draw the instances of each level at once
+    for (unsigned int l = 0; l < level_.size(); l++){
+        if (level_[l].num_instances > 0){
+            state->BindVertexArray(level_[l].vertex_array);
+            glDrawElementsInstanced(GetMode(), level_[l].geometry->GetSize(), GL_UNSIGNED_INT, 0, level_[l].num_instances);
+        }
+    }
+}
+
+} // namespace game
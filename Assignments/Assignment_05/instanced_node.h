@@ -0,0 +1,106 @@
+#ifndef INSTANCED_NODE_H_
+#define INSTANCED_NODE_H_
+
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/quaternion.hpp>
+
+#include "resource.h"
+#include "scene_node.h"
+
+namespace game {
+
+    // Scene node that draws many copies of one geometry with a single
+    // instanced draw call (one per level of detail of the geometry)
+    // Each instance has its own position, orientation and scale, stored in
+    // instance buffers read by the material (see material_instanced_vp.glsl).
+    // The transformation of the node itself applies to all instances
+    class InstancedNode : public SceneNode {
+
+        public:
+            // Create instanced node from given resources
+            InstancedNode(const std::string name, const Resource *geometry, const Resource *material, const Resource *texture = NULL);
+
+            // Destructor
+            ~InstancedNode();
+
+            // Add an instance and return its index
+            int AddInstance(glm::vec3 position, glm::quat orientation, glm::vec3 scale = glm::vec3(1.0, 1.0, 1.0));
+            // Get number of instances
+            int GetNumInstances(void) const;
+
+            // Get instance attributes
+            glm::vec3 GetInstancePosition(int index) const;
+            glm::quat GetInstanceOrientation(int index) const;
+            glm::vec3 GetInstanceScale(int index) const;
+
+            // Set instance attributes
+            void SetInstancePosition(int index, glm::vec3 position);
+            void SetInstanceOrientation(int index, glm::quat orientation);
+            void SetInstanceScale(int index, glm::vec3 scale);
+
+            // Bounding sphere of all instances, so that the node is culled
+            // when none of them can be visible
+            bool GetWorldBounds(glm::vec3 &center, float &radius) const;
+
+            // Select the level of detail of each instance from its
+            // projected size
+            void SelectLevelOfDetail(const Camera *camera);
+
+        protected:
+            // Instance attributes, one array per instance buffer
+            // glm stores quaternions as (x, y, z, w), which is the order the
+            // shader reads them in
+            std::vector<glm::vec3> instance_position_;
+            std::vector<glm::quat> instance_orientation_;
+            std::vector<glm::vec3> instance_scale_;
+
+            // Mark instance attributes as modified, so that they are
+            // uploaded before the next draw; unless only orientations
+            // changed (which do not move the bounds), the bounding sphere
+            // is recomputed as well
+            void InvalidateInstances(bool bounds = true);
+
+            // Upload the instance buffers if needed and draw all instances
+            void DrawGeometry(RenderState *state);
+
+        private:
+            // Instances drawn with one level of detail of the geometry
+            struct LevelBatch {
+                const Resource *geometry;
+                GLuint vertex_array; // Geometry and instance buffer layout
+                GLuint instance_buffer[3]; // Position, orientation and scale
+                GLsizei num_instances;
+            };
+            const Resource *geometry_;
+            std::vector<LevelBatch> level_;
+            // Level of detail of each instance
+            std::vector<unsigned char> instance_level_;
+            bool instances_dirty_; // Instance buffers need to be uploaded
+
+            // Bounding sphere of the instances in object coordinates,
+            // computed when needed after instances move
+            mutable glm::vec3 bounds_center_;
+            mutable float bounds_radius_;
+            mutable bool bounds_dirty_;
+
+            // Instance attributes gathered by level before uploading
+            std::vector<glm::vec3> batch_position_;
+            std::vector<glm::quat> batch_orientation_;
+            std::vector<glm::vec3> batch_scale_;
+
+            // Set up the vertex array and instance buffers of each level
+            void SetupLevels(void);
+            // Upload the instances of one level
+            void UploadLevel(LevelBatch &batch, const glm::vec3 *position, const glm::quat *orientation, const glm::vec3 *scale, GLsizei num_instances);
+
+    }; // class InstancedNode
+
+} // namespace game
+
+#endif // INSTANCED_NODE_H_
@@ -0,0 +1,167 @@
+#include "job_system.h"
+
+namespace game {
+
+// Queue used by the current thread; threads outside the pool use queue 0
+static thread_local int current_queue = 0;
+
+
+JobSystem::JobSystem(int num_workers){
+
+    if (num_workers < 0){
+        num_workers = (int) std::thread::hardware_concurrency() - 1;
+        if (num_workers < 0){
+            num_workers = 0;
+        }
+    }
+
+    pending_ = 0;
+    quit_ = false;
+    for (int i = 0; i < num_workers + 1; i++){
+        queue_.push_back(new WorkQueue());
+    }
+    for (int i = 0; i < num_workers; i++){
+        worker_.push_back(std::thread(&JobSystem::WorkerLoop, this, i + 1));
+    }
+}
+
+
+JobSystem::~JobSystem(){
+
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    for (unsigned int i = 0; i < worker_.size(); i++){
+        worker_[i].join();
+    }
+    for (unsigned int i = 0; i < queue_.size(); i++){
+        delete queue_[i];
+    }
+}
+
+
+JobSystem &JobSystem::GetInstance(void){
+
+    static JobSystem instance;
+    return instance;
+}
+
+
+int JobSystem::GetNumThreads(void) const {
+
+    return (int) worker_.size() + 1;
+}
+
+
+void JobSystem::ParallelFor(int count, int chunk_size, const std::function<void (int, int)> &func){
+
+    if (count <= 0){
+        return;
+    }
+    if (chunk_size < 1){
+        chunk_size = 1;
+    }
+
+    // Not worth distributing: run on the calling thread
+    int num_chunks = (count + chunk_size - 1) / chunk_size;
+    if (worker_.empty() || num_chunks == 1){
+        func(0, count);
+        return;
+    }
+
+    // Deal the chunks out over all queues, starting with our own
+    std::atomic<int> remaining(num_chunks);
+    int num_queues = (int) queue_.size();
+    for (int q = 0; q < num_queues; q++){
+        int index = (current_queue + q) % num_queues;
+        std::lock_guard<std::mutex> lock(queue_[index]->mutex);
+        for (int c = q; c < num_chunks; c += num_queues){
+            Job job;
+            job.func = &func;
+            job.begin = c*chunk_size;
+            job.end = (job.begin + chunk_size < count) ? job.begin + chunk_size : count;
+            job.remaining = &remaining;
+            queue_[index]->jobs.push_back(job);
+        }
+    }
+
+    // Update the count under the lock, so that a worker about to sleep
+    // cannot miss the notification
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        pending_ += num_chunks;
+    }
+    wake_.notify_all();
+
+    // Help until our chunks are done; other threads may still be running
+    // the last ones
+    while (remaining > 0){
+        Job job;
+        if (TakeJob(current_queue, job)){
+            RunJob(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+
+void JobSystem::WorkerLoop(int queue_index){
+
+    current_queue = queue_index;
+    while (true){
+        Job job;
+        if (TakeJob(queue_index, job)){
+            RunJob(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this]{ return quit_ || pending_ > 0; });
+        if (quit_){
+            return;
+        }
+    }
+}
+
+
+bool JobSystem::TakeJob(int queue_index, Job &job){
+
+    // Own queue first, newest job first
+    {
+        WorkQueue *queue = queue_[queue_index];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (!queue->jobs.empty()){
+            job = queue->jobs.back();
+            queue->jobs.pop_back();
+            pending_--;
+            return true;
+        }
+    }
+
+    // Steal the oldest job of another queue
+    int num_queues = (int) queue_.size();
+    for (int i = 1; i < num_queues; i++){
+        WorkQueue *queue = queue_[(queue_index + i) % num_queues];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (!queue->jobs.empty()){
+            job = queue->jobs.front();
+            queue->jobs.pop_front();
+            pending_--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void JobSystem::RunJob(const Job &job){
+
+    (*job.func)(job.begin, job.end);
+    (*job.remaining)--;
+}
+
+} // namespace game
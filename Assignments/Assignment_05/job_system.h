@@ -0,0 +1,78 @@
+#ifndef JOB_SYSTEM_H_
+#define JOB_SYSTEM_H_
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace game {
+
+    // Fixed pool of worker threads that run chunks of parallel loops
+    // Every thread (workers and callers) has its own queue of jobs; a
+    // thread takes jobs from the back of its own queue and, when it runs
+    // out, steals from the front of the others
+    class JobSystem {
+
+        public:
+            // Start num_workers threads; a negative number uses one
+            // thread per core besides the calling thread
+            JobSystem(int num_workers = -1);
+            // Stop and join the workers
+            ~JobSystem();
+
+            // Job system shared by the whole program
+            static JobSystem &GetInstance(void);
+
+            // Number of threads that run jobs, including the caller
+            int GetNumThreads(void) const;
+
+            // Call func(begin, end) on consecutive ranges of at most
+            // chunk_size indices covering [0, count), and return once all
+            // ranges are done. The calling thread runs jobs while it waits,
+            // so func may itself call ParallelFor. func is called
+            // concurrently from several threads and must not throw
+            void ParallelFor(int count, int chunk_size, const std::function<void (int, int)> &func);
+
+        private:
+            // A range of a parallel loop
+            struct Job {
+                const std::function<void (int, int)> *func;
+                int begin;
+                int end;
+                std::atomic<int> *remaining;
+            };
+
+            // Queue of one thread
+            struct WorkQueue {
+                std::mutex mutex;
+                std::deque<Job> jobs;
+            };
+
+            // Queue 0 belongs to threads outside the pool, queue i + 1 to
+            // worker i
+            std::vector<WorkQueue *> queue_;
+            std::vector<std::thread> worker_;
+
+            // Workers sleep on wake_ while no jobs are queued
+            std::mutex wake_mutex_;
+            std::condition_variable wake_;
+            std::atomic<int> pending_;
+            bool quit_;
+
+            // Main function of worker threads
+            void WorkerLoop(int queue_index);
+            // Take a job from queue queue_index or steal one from another
+            // queue; returns false if all queues are empty
+            bool TakeJob(int queue_index, Job &job);
+            // Run a job and mark it as done
+            void RunJob(const Job &job);
+
+    }; // class JobSystem
+
+} // namespace game
+
+#endif // JOB_SYSTEM_H_
@@ -0,0 +1,125 @@
+#include <stdexcept>
+#include <ios>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+
+namespace game {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &filename){
+
+    data_ = NULL;
+    size_ = 0;
+    mapping_ = NULL;
+
+    // Others may still write the file in place (e.g., to update a field of
+    // a cache header), as on other systems
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        throw(std::ios_base::failure(std::string("Error opening file ")+filename));
+    }
+    file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)){
+        CloseHandle(file);
+        throw(std::ios_base::failure(std::string("Error reading size of file ")+filename));
+    }
+    size_ = (size_t) size.QuadPart;
+    if (size_ == 0){
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void *view = (mapping != NULL) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (view == NULL){
+        if (mapping != NULL){
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        throw(std::ios_base::failure(std::string("Error mapping file ")+filename));
+    }
+    mapping_ = mapping;
+    data_ = (const char *) view;
+}
+
+
+MappedFile::~MappedFile(){
+
+    if (data_){
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_){
+        CloseHandle((HANDLE) mapping_);
+    }
+    CloseHandle((HANDLE) file_);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &filename){
+
+    data_ = NULL;
+    size_ = 0;
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw(std::ios_base::failure(std::string("Error opening file ")+filename));
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0){
+        close(fd);
+        throw(std::ios_base::failure(std::string("Error reading size of file ")+filename));
+    }
+    size_ = (size_t) info.st_size;
+    if (size_ == 0){
+        close(fd);
+        return;
+    }
+
+    void *view = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (view == MAP_FAILED){
+        throw(std::ios_base::failure(std::string("Error mapping file ")+filename));
+    }
+    // The file is read front to back
+    madvise(view, size_, MADV_SEQUENTIAL);
+    data_ = (const char *) view;
+}
+
+
+MappedFile::~MappedFile(){
+
+    if (data_){
+        munmap((void *) data_, size_);
+    }
+}
+
+#endif
+
+
+const char *MappedFile::GetData(void) const {
+
+    return data_;
+}
+
+
+size_t MappedFile::GetSize(void) const {
+
+    return size_;
+}
+
+} // namespace game
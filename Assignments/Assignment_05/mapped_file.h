@@ -0,0 +1,41 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <string>
+#include <cstddef>
+
+namespace game {
+
+    // Read-only view of a whole file mapped into memory
+    // The contents are paged in by the operating system as they are read,
+    // so large files are not copied into a buffer first
+    class MappedFile {
+
+        public:
+            // Map the file; throws std::ios_base::failure if it cannot be
+            // opened
+            MappedFile(const std::string &filename);
+            // Unmap the file
+            ~MappedFile();
+
+            // Contents of the file; null if the file is empty
+            const char *GetData(void) const;
+            size_t GetSize(void) const;
+
+        private:
+            const char *data_;
+            size_t size_;
+#ifdef _WIN32
+            void *file_;
+            void *mapping_;
+#endif
+
+            // Mappings cannot be copied
+            MappedFile(const MappedFile &);
+            MappedFile &operator=(const MappedFile &);
+
+    }; // class MappedFile
+
+} // namespace game
+
+#endif // MAPPED_FILE_H_
@@ -0,0 +1,38 @@
+// Material with no illumination simulation, drawn with instancing
+
+#version 130
+
+// Vertex buffer
+in vec3 vertex;
+in vec3 color;
+
+// Instance buffers
+in vec3 instance_position;
+in vec4 instance_orientation; // Quaternion (x, y, z, w)
+in vec3 instance_scale;
+
+// Uniform (global) buffer
+uniform mat4 world_mat;
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+
+// Attributes forwarded to the fragment shader
+out vec4 color_interp;
+
+
+// Rotate a vector by a unit quaternion
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0*cross(q.xyz, cross(q.xyz, v) + q.w*v);
+}
+
+
+void main()
+{
+    // Instance transformation: scale, then rotate, then translate
+    vec3 position = instance_position + rotate(instance_orientation, vertex*instance_scale);
+
+    gl_Position = projection_mat * view_mat * world_mat * vec4(position, 1.0);
+
+    color_interp = vec4(color, 1.0);
+}
@@ -0,0 +1,208 @@
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+#include "mesh_cache.h"
+#include "hash.h"
+
+// Identification of cache files; change the version when the layout changes
+#define MESH_CACHE_MAGIC "MSHC"
+#define MESH_CACHE_VERSION 2
+
+namespace game {
+
+// Keeps the blocks that follow the header aligned
+static_assert(sizeof(MeshCacheHeader) == 72, "unexpected mesh cache header size");
+
+
+MeshCache::MeshCache(const std::string &source_filename, int vertex_att, uint64_t options){
+
+    file_ = NULL;
+    header_ = NULL;
+
+    try {
+        file_ = new MappedFile(source_filename + std::string(MESH_CACHE_EXTENSION));
+    }
+    catch (std::ios_base::failure &){
+        // No cache yet
+        return;
+    }
+
+    // Check that the cache is complete and has the expected layout
+    if (file_->GetSize() < sizeof(MeshCacheHeader)){
+        return;
+    }
+    const MeshCacheHeader *header = (const MeshCacheHeader *) file_->GetData();
+    if ((memcmp(header->magic, MESH_CACHE_MAGIC, 4) != 0) ||
+        (header->version != MESH_CACHE_VERSION) ||
+        (header->vertex_att != (uint32_t) vertex_att) ||
+        (header->options != options)){
+        return;
+    }
+    size_t size = sizeof(MeshCacheHeader) +
+                  (size_t) header->num_vertices * header->vertex_att * sizeof(GLfloat) +
+                  (size_t) header->num_indices * sizeof(GLuint);
+    if (file_->GetSize() != size){
+        return;
+    }
+
+    // Check that the source did not change: same size and modification
+    // time, or, if only the time changed (e.g., the file was copied), the
+    // same contents. In the latter case the new time is recorded, so that
+    // the source is only hashed again after its next change
+    uint64_t source_size;
+    int64_t source_time;
+    if (!GetSourceInfo(source_filename, source_size, source_time, NULL) ||
+        (source_size != header->source_size)){
+        return;
+    }
+    if (source_time != header->source_time){
+        uint64_t source_hash;
+        if (!GetSourceInfo(source_filename, source_size, source_time, &source_hash) ||
+            (source_hash != header->source_hash)){
+            return;
+        }
+        UpdateSourceTime(source_filename, source_time);
+    }
+
+    header_ = header;
+}
+
+
+MeshCache::~MeshCache(){
+
+    delete file_;
+}
+
+
+bool MeshCache::IsValid(void) const {
+
+    return header_ != NULL;
+}
+
+
+const GLfloat *MeshCache::GetVertices(void) const {
+
+    return (const GLfloat *) (file_->GetData() + sizeof(MeshCacheHeader));
+}
+
+
+GLsizei MeshCache::GetNumVertices(void) const {
+
+    return (GLsizei) header_->num_vertices;
+}
+
+
+const GLuint *MeshCache::GetIndices(void) const {
+
+    return (const GLuint *) (GetVertices() + (size_t) header_->num_vertices * header_->vertex_att);
+}
+
+
+GLsizei MeshCache::GetNumIndices(void) const {
+
+    return (GLsizei) header_->num_indices;
+}
+
+
+glm::vec3 MeshCache::GetBoundingCenter(void) const {
+
+    return glm::vec3(header_->center[0], header_->center[1], header_->center[2]);
+}
+
+
+float MeshCache::GetBoundingRadius(void) const {
+
+    return header_->radius;
+}
+
+
+bool MeshCache::Write(const std::string &source_filename, int vertex_att, uint64_t options, const GLfloat *vertex, GLsizei num_vertices, const GLuint *index, GLsizei num_indices, glm::vec3 center, float radius){
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+    header.version = MESH_CACHE_VERSION;
+    if (!GetSourceInfo(source_filename, header.source_size, header.source_time, &header.source_hash)){
+        return false;
+    }
+    header.options = options;
+    header.num_vertices = (uint32_t) num_vertices;
+    header.vertex_att = (uint32_t) vertex_att;
+    header.num_indices = (uint32_t) num_indices;
+    header.center[0] = center[0];
+    header.center[1] = center[1];
+    header.center[2] = center[2];
+    header.radius = radius;
+
+    // Write to a temporary file and rename it, so that a partly written
+    // cache is never picked up
+    std::string cache_filename = source_filename + std::string(MESH_CACHE_EXTENSION);
+    std::string temp_filename = cache_filename + std::string(".tmp");
+    std::ofstream f(temp_filename.c_str(), std::ios::binary | std::ios::trunc);
+    if (f.fail()){
+        return false;
+    }
+    f.write((const char *) &header, sizeof(header));
+    f.write((const char *) vertex, (std::streamsize) num_vertices * vertex_att * sizeof(GLfloat));
+    f.write((const char *) index, (std::streamsize) num_indices * sizeof(GLuint));
+    f.close();
+    if (f.fail()){
+        std::remove(temp_filename.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_filename, cache_filename, error);
+    if (error){
+        std::remove(temp_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool MeshCache::UpdateSourceTime(const std::string &source_filename, int64_t time){
+
+    // Only the time is rewritten, in place; the mapped blocks stay valid
+    std::string cache_filename = source_filename + std::string(MESH_CACHE_EXTENSION);
+    std::fstream f(cache_filename.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+    if (f.fail()){
+        return false;
+    }
+    f.seekp(offsetof(MeshCacheHeader, source_time));
+    f.write((const char *) &time, sizeof(time));
+    f.close();
+    return !f.fail();
+}
+
+
+bool MeshCache::GetSourceInfo(const std::string &source_filename, uint64_t &size, int64_t &time, uint64_t *hash){
+
+    std::error_code error;
+    std::filesystem::path path(source_filename);
+    size = (uint64_t) std::filesystem::file_size(path, error);
+    if (error){
+        return false;
+    }
+    time = (int64_t) std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    if (error){
+        return false;
+    }
+
+    if (hash){
+        try {
+            MappedFile file(source_filename);
+            *hash = HashBytes(file.GetData(), file.GetSize());
+        }
+        catch (std::ios_base::failure &){
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace game
@@ -0,0 +1,84 @@
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <string>
+#include <cstdint>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "mapped_file.h"
+
+// Appended to the name of a source mesh to name its cache
+#define MESH_CACHE_EXTENSION ".meshcache"
+
+namespace game {
+
+    // Binary copy of a loaded mesh, stored next to its source file so that
+    // later runs can skip parsing and processing. The cache records the
+    // settings of the processing (a hash chosen by the caller), so that a
+    // cache built with other settings is rebuilt
+    // Layout: MeshCacheHeader, vertex block (num_vertices * vertex_att
+    // floats, interleaved as in the vertex buffers), index block
+    // (num_indices unsigned ints). Values are in the byte order of the
+    // machine that wrote the cache
+    struct MeshCacheHeader {
+        char magic[4];
+        uint32_t version;
+        // Source file the cache was built from
+        uint64_t source_size;
+        int64_t source_time;
+        uint64_t source_hash;
+        // Settings of the processing applied after parsing
+        uint64_t options;
+        // Geometry
+        uint32_t num_vertices;
+        uint32_t vertex_att;
+        uint32_t num_indices;
+        uint32_t reserved;
+        // Bounding sphere
+        float center[3];
+        float radius;
+    };
+
+    // Mesh read from a cache; the blocks point into the mapped file
+    class MeshCache {
+
+        public:
+            // Map the cache of source_filename and check that it is
+            // complete and was built from the current source file with the
+            // given options. If not, IsValid returns false
+            MeshCache(const std::string &source_filename, int vertex_att, uint64_t options);
+            ~MeshCache();
+
+            bool IsValid(void) const;
+
+            // Contents, only meaningful if the cache is valid
+            const GLfloat *GetVertices(void) const;
+            GLsizei GetNumVertices(void) const;
+            const GLuint *GetIndices(void) const;
+            GLsizei GetNumIndices(void) const;
+            glm::vec3 GetBoundingCenter(void) const;
+            float GetBoundingRadius(void) const;
+
+            // Write the cache of source_filename; returns false if it
+            // could not be written (e.g., read-only directory)
+            static bool Write(const std::string &source_filename, int vertex_att, uint64_t options, const GLfloat *vertex, GLsizei num_vertices, const GLuint *index, GLsizei num_indices, glm::vec3 center, float radius);
+
+        private:
+            MappedFile *file_;
+            const MeshCacheHeader *header_;
+
+            // Identify the current version of a source file; the hash is
+            // only computed if hash is not null
+            static bool GetSourceInfo(const std::string &source_filename, uint64_t &size, int64_t &time, uint64_t *hash);
+            // Record a new modification time of the unchanged source in the
+            // header of its cache; returns false if the cache could not be
+            // written
+            static bool UpdateSourceTime(const std::string &source_filename, int64_t time);
+
+    }; // class MeshCache
+
+} // namespace game
+
+#endif // MESH_CACHE_H_
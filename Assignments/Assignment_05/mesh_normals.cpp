@@ -0,0 +1,87 @@
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "mesh_normals.h"
+#include "job_system.h"
+
+// Number of triangles or vertices processed by one job
+#define NORMAL_CHUNK_SIZE 16384
+
+namespace game {
+
+static inline glm::vec3 ReadVec3(const GLfloat *data, int stride, GLuint index){
+
+    const GLfloat *v = data + (size_t) index * stride;
+    return glm::vec3(v[0], v[1], v[2]);
+}
+
+
+void ComputeVertexNormals(const GLfloat *position, int position_stride, GLfloat *normal, int normal_stride, int num_vertices, const GLuint *index, int num_triangles, bool angle_weighted){
+
+    JobSystem &jobs = JobSystem::GetInstance();
+
+    // Contribution of every triangle corner, computed in parallel since
+    // triangles are independent
+    std::vector<glm::vec3> corner(3 * (size_t) num_triangles);
+    jobs.ParallelFor(num_triangles, NORMAL_CHUNK_SIZE, [&](int begin, int end){
+        for (int i = begin; i < end; i++){
+            const GLuint *tri = index + 3*i;
+            glm::vec3 p[3];
+            for (int j = 0; j < 3; j++){
+                p[j] = ReadVec3(position, position_stride, tri[j]);
+            }
+            glm::vec3 norm = glm::cross(p[1] - p[0], p[2] - p[0]);
+            float length = glm::length(norm);
+            // Degenerate triangles have no direction
+            norm = (length > 0.0f) ? norm / length : glm::vec3(0.0, 0.0, 0.0);
+            for (int j = 0; j < 3; j++){
+                float weight = 1.0f;
+                if (angle_weighted){
+                    glm::vec3 e1 = p[(j + 1) % 3] - p[j];
+                    glm::vec3 e2 = p[(j + 2) % 3] - p[j];
+                    float l = glm::length(e1) * glm::length(e2);
+                    weight = (l > 0.0f) ? acosf(glm::clamp(glm::dot(e1, e2) / l, -1.0f, 1.0f)) : 0.0f;
+                }
+                corner[3*(size_t) i + j] = norm * weight;
+            }
+        }
+    });
+
+    // List the corners of each vertex (compressed rows: the corners of
+    // vertex v are corner_list[first[v]] to corner_list[first[v + 1] - 1]),
+    // so that each vertex can gather its own contributions without
+    // synchronizing with other threads
+    std::vector<int> first(num_vertices + 1, 0);
+    for (size_t c = 0; c < 3 * (size_t) num_triangles; c++){
+        first[index[c] + 1]++;
+    }
+    for (int v = 0; v < num_vertices; v++){
+        first[v + 1] += first[v];
+    }
+    std::vector<int> fill(first.begin(), first.end() - 1);
+    std::vector<int> corner_list(3 * (size_t) num_triangles);
+    for (size_t c = 0; c < 3 * (size_t) num_triangles; c++){
+        corner_list[fill[index[c]]++] = (int) c;
+    }
+
+    // Sum and normalize per vertex
+    jobs.ParallelFor(num_vertices, NORMAL_CHUNK_SIZE, [&](int begin, int end){
+        for (int v = begin; v < end; v++){
+            glm::vec3 sum(0.0, 0.0, 0.0);
+            for (int k = first[v]; k < first[v + 1]; k++){
+                sum += corner[corner_list[k]];
+            }
+            float length = glm::length(sum);
+            if (length > 0.0f){
+                sum /= length;
+            }
+            GLfloat *n = normal + (size_t) v * normal_stride;
+            n[0] = sum[0];
+            n[1] = sum[1];
+            n[2] = sum[2];
+        }
+    });
+}
+
+} // namespace game
@@ -0,0 +1,25 @@
+#ifndef MESH_NORMALS_H_
+#define MESH_NORMALS_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Identifies the normals the function computes; change it when they
+// change, so that stored results are rebuilt
+#define MESH_NORMALS_VERSION 1
+
+namespace game {
+
+    // Compute smooth vertex normals of a triangle mesh as the normalized
+    // average of the normals of the faces around each vertex
+    // Positions and normals are read and written as three floats every
+    // stride floats, so the function works both on separate arrays
+    // (stride 3) and on interleaved vertex buffers. If angle_weighted is
+    // set, each face contributes in proportion to its angle at the vertex,
+    // which makes the result independent of how a surface is triangulated
+    // The work is split over the threads of the job system
+    void ComputeVertexNormals(const GLfloat *position, int position_stride, GLfloat *normal, int normal_stride, int num_vertices, const GLuint *index, int num_triangles, bool angle_weighted = false);
+
+} // namespace game
+
+#endif // MESH_NORMALS_H_
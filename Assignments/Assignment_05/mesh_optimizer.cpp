@@ -0,0 +1,295 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "mesh_optimizer.h"
+
+// Size of the first-in first-out cache used to measure ACMR and to cut
+// triangle groups for overdraw ordering
+#define FIFO_CACHE_SIZE 16
+// Size of the least-recently-used cache modelled by the optimization
+#define LRU_CACHE_SIZE 32
+
+namespace game {
+
+float ComputeACMR(const GLuint *index, int num_indices, int num_vertices){
+
+    if (num_indices < 3){
+        return 0.0f;
+    }
+
+    // Time at which each vertex entered the cache; a vertex is in the
+    // cache if fewer than FIFO_CACHE_SIZE misses happened since
+    std::vector<int> entered(num_vertices, -FIFO_CACHE_SIZE - 1);
+    int misses = 0;
+    for (int i = 0; i < num_indices; i++){
+        if (misses - entered[index[i]] > FIFO_CACHE_SIZE){
+            entered[index[i]] = misses;
+            misses++;
+        }
+    }
+    return (float) misses / (float) (num_indices / 3);
+}
+
+
+// Score of a vertex given its position in the cache and the number of
+// triangles still to be emitted that use it (Forsyth)
+static float VertexScore(int cache_position, int active_triangles){
+
+    if (active_triangles == 0){
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0){
+        if (cache_position < 3){
+            // Vertices of the last triangle get a fixed score, so that the
+            // next triangle does not always reuse the same edge
+            score = 0.75f;
+        } else {
+            float scaler = 1.0f / (LRU_CACHE_SIZE - 3);
+            score = powf(1.0f - (cache_position - 3) * scaler, 1.5f);
+        }
+    }
+    // Favor vertices with few triangles left, to finish them off
+    score += 2.0f * powf((float) active_triangles, -0.5f);
+    return score;
+}
+
+
+void OptimizeVertexCache(GLuint *index, int num_indices, int num_vertices){
+
+    int num_triangles = num_indices / 3;
+    if (num_triangles < 2){
+        return;
+    }
+
+    // Triangles of each vertex, in compressed rows; the first
+    // active[v] entries of a row are the triangles not emitted yet
+    std::vector<int> first(num_vertices + 1, 0);
+    for (int i = 0; i < num_indices; i++){
+        first[index[i] + 1]++;
+    }
+    for (int v = 0; v < num_vertices; v++){
+        first[v + 1] += first[v];
+    }
+    std::vector<int> active(num_vertices, 0);
+    std::vector<int> triangle_list(num_indices);
+    for (int i = 0; i < num_indices; i++){
+        GLuint v = index[i];
+        triangle_list[first[v] + active[v]++] = i / 3;
+    }
+
+    std::vector<int> cache_position(num_vertices, -1);
+    std::vector<float> vertex_score(num_vertices);
+    for (int v = 0; v < num_vertices; v++){
+        vertex_score[v] = VertexScore(-1, active[v]);
+    }
+    std::vector<float> triangle_score(num_triangles);
+    std::vector<bool> emitted(num_triangles, false);
+    for (int t = 0; t < num_triangles; t++){
+        triangle_score[t] = vertex_score[index[3*t]] + vertex_score[index[3*t + 1]] + vertex_score[index[3*t + 2]];
+    }
+
+    std::vector<GLuint> output(num_indices);
+    std::vector<int> cache, new_cache;
+    cache.reserve(LRU_CACHE_SIZE + 3);
+    new_cache.reserve(LRU_CACHE_SIZE + 3);
+
+    // Start with the best triangle overall
+    int best = 0;
+    for (int t = 1; t < num_triangles; t++){
+        if (triangle_score[t] > triangle_score[best]){
+            best = t;
+        }
+    }
+    // Position of the next triangle to check when the cache has no
+    // candidates left
+    int scan = 0;
+
+    for (int n = 0; n < num_triangles; n++){
+        if (best < 0){
+            // Nothing in the cache touches a remaining triangle: take the
+            // next one in the original order
+            while (emitted[scan]){
+                scan++;
+            }
+            best = scan;
+        }
+
+        // Emit the triangle and remove it from the lists of its vertices
+        emitted[best] = true;
+        for (int j = 0; j < 3; j++){
+            GLuint v = index[3*best + j];
+            output[3*n + j] = v;
+            int *row = &triangle_list[first[v]];
+            for (int k = 0; k < active[v]; k++){
+                if (row[k] == best){
+                    row[k] = row[active[v] - 1];
+                    active[v]--;
+                    break;
+                }
+            }
+        }
+
+        // Move the triangle's vertices to the front of the cache
+        new_cache.clear();
+        for (int j = 0; j < 3; j++){
+            new_cache.push_back(index[3*best + j]);
+        }
+        for (int k = 0; k < (int) cache.size(); k++){
+            GLuint v = cache[k];
+            if ((v != index[3*best]) && (v != index[3*best + 1]) && (v != index[3*best + 2])){
+                new_cache.push_back(v);
+            }
+        }
+
+        // Update the scores of the vertices in (or just evicted from) the
+        // cache and of their remaining triangles; pick the best of those
+        best = -1;
+        float best_score = -1.0f;
+        for (int k = 0; k < (int) new_cache.size(); k++){
+            int v = new_cache[k];
+            cache_position[v] = (k < LRU_CACHE_SIZE) ? k : -1;
+            vertex_score[v] = VertexScore(cache_position[v], active[v]);
+        }
+        for (int k = 0; k < (int) new_cache.size(); k++){
+            int v = new_cache[k];
+            for (int r = 0; r < active[v]; r++){
+                int t = triangle_list[first[v] + r];
+                triangle_score[t] = vertex_score[index[3*t]] + vertex_score[index[3*t + 1]] + vertex_score[index[3*t + 2]];
+                if (triangle_score[t] > best_score){
+                    best_score = triangle_score[t];
+                    best = t;
+                }
+            }
+        }
+
+        if (new_cache.size() > LRU_CACHE_SIZE){
+            new_cache.resize(LRU_CACHE_SIZE);
+        }
+        cache.swap(new_cache);
+    }
+
+    std::copy(output.begin(), output.end(), index);
+}
+
+
+void OptimizeOverdraw(GLuint *index, int num_indices, const GLfloat *vertex, int vertex_att, int num_vertices){
+
+    int num_triangles = num_indices / 3;
+    if (num_triangles < 2){
+        return;
+    }
+
+    // A group of consecutive triangles
+    struct Cluster {
+        int begin;
+        int end;
+        float sort_key;
+    };
+
+    // Cut a new group wherever a triangle misses the cache on all three
+    // vertices: reordering groups then barely changes the cache behavior
+    std::vector<Cluster> cluster;
+    std::vector<int> entered(num_vertices, -FIFO_CACHE_SIZE - 1);
+    int misses = 0;
+    for (int t = 0; t < num_triangles; t++){
+        int triangle_misses = 0;
+        for (int j = 0; j < 3; j++){
+            GLuint v = index[3*t + j];
+            if (misses - entered[v] > FIFO_CACHE_SIZE){
+                entered[v] = misses;
+                misses++;
+                triangle_misses++;
+            }
+        }
+        if ((t == 0) || (triangle_misses == 3)){
+            Cluster c;
+            c.begin = t;
+            c.sort_key = 0.0f;
+            cluster.push_back(c);
+        }
+        cluster.back().end = t + 1;
+    }
+
+    // Area-weighted centroid and normal of every group and of the mesh
+    std::vector<glm::vec3> cluster_center(cluster.size());
+    std::vector<glm::vec3> cluster_normal(cluster.size());
+    glm::vec3 mesh_center(0.0, 0.0, 0.0);
+    float mesh_area = 0.0f;
+    for (int c = 0; c < (int) cluster.size(); c++){
+        glm::vec3 center(0.0, 0.0, 0.0);
+        glm::vec3 normal(0.0, 0.0, 0.0);
+        float area = 0.0f;
+        for (int t = cluster[c].begin; t < cluster[c].end; t++){
+            glm::vec3 p[3];
+            for (int j = 0; j < 3; j++){
+                const GLfloat *v = vertex + (size_t) index[3*t + j] * vertex_att;
+                p[j] = glm::vec3(v[0], v[1], v[2]);
+            }
+            glm::vec3 cross = glm::cross(p[1] - p[0], p[2] - p[0]);
+            float a = glm::length(cross);
+            center += (p[0] + p[1] + p[2]) * (a / 3.0f);
+            normal += cross;
+            area += a;
+        }
+        cluster_center[c] = (area > 0.0f) ? center / area : center;
+        cluster_normal[c] = normal;
+        mesh_center += center;
+        mesh_area += area;
+    }
+    if (mesh_area > 0.0f){
+        mesh_center /= mesh_area;
+    }
+
+    // Groups far out along their normal are likely in front of the rest
+    for (int c = 0; c < (int) cluster.size(); c++){
+        float length = glm::length(cluster_normal[c]);
+        if (length > 0.0f){
+            cluster[c].sort_key = glm::dot(cluster_center[c] - mesh_center, cluster_normal[c] / length);
+        }
+    }
+    std::stable_sort(cluster.begin(), cluster.end(), [](const Cluster &a, const Cluster &b){
+        return a.sort_key > b.sort_key;
+    });
+
+    std::vector<GLuint> output;
+    output.reserve(num_indices);
+    for (int c = 0; c < (int) cluster.size(); c++){
+        output.insert(output.end(), index + 3*cluster[c].begin, index + 3*cluster[c].end);
+    }
+    std::copy(output.begin(), output.end(), index);
+}
+
+
+int OptimizeVertexFetch(GLfloat *vertex, int vertex_att, int num_vertices, GLuint *index, int num_indices){
+
+    std::vector<int> remap(num_vertices, -1);
+    std::vector<GLfloat> output;
+    output.reserve((size_t) num_vertices * vertex_att);
+    int count = 0;
+    for (int i = 0; i < num_indices; i++){
+        GLuint v = index[i];
+        if (remap[v] < 0){
+            remap[v] = count++;
+            output.insert(output.end(), vertex + (size_t) v * vertex_att, vertex + (size_t) (v + 1) * vertex_att);
+        }
+        index[i] = (GLuint) remap[v];
+    }
+    std::copy(output.begin(), output.end(), vertex);
+    return count;
+}
+
+
+int OptimizeMesh(GLfloat *vertex, int vertex_att, int num_vertices, GLuint *index, int num_indices, bool optimize_overdraw){
+
+    OptimizeVertexCache(index, num_indices, num_vertices);
+    if (optimize_overdraw){
+        OptimizeOverdraw(index, num_indices, vertex, vertex_att, num_vertices);
+    }
+    return OptimizeVertexFetch(vertex, vertex_att, num_vertices, index, num_indices);
+}
+
+} // namespace game
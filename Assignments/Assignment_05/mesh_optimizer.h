@@ -0,0 +1,43 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Identifies the order the optimizer produces; change it when the
+// functions (or their settings) change, so that stored results are rebuilt
+#define MESH_OPTIMIZER_VERSION 1
+
+namespace game {
+
+    // Reordering of indexed triangle meshes so that the GPU runs the
+    // vertex shader fewer times and fetches vertices more locally
+    // Vertices are interleaved, with the position in the first three of
+    // every vertex_att floats
+
+    // Average number of vertex shader runs per triangle (ACMR) for a
+    // first-in first-out post-transform cache; between 0.5 and 3, lower
+    // is better
+    float ComputeACMR(const GLuint *index, int num_indices, int num_vertices);
+
+    // Reorder triangles for the post-transform vertex cache, using Tom
+    // Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    void OptimizeVertexCache(GLuint *index, int num_indices, int num_vertices);
+
+    // Reorder groups of triangles (cut where the vertex cache flushes) so
+    // that the ones facing away from the center of the mesh come first and
+    // occlude the others, which reduces overdraw of non-convex meshes at a
+    // small cost in cache efficiency. Call after OptimizeVertexCache
+    void OptimizeOverdraw(GLuint *index, int num_indices, const GLfloat *vertex, int vertex_att, int num_vertices);
+
+    // Renumber vertices in the order the triangles first use them and drop
+    // unused ones, so that vertex fetches walk through memory; returns the
+    // new number of vertices
+    int OptimizeVertexFetch(GLfloat *vertex, int vertex_att, int num_vertices, GLuint *index, int num_indices);
+
+    // All of the above in order; returns the new number of vertices
+    int OptimizeMesh(GLfloat *vertex, int vertex_att, int num_vertices, GLuint *index, int num_indices, bool optimize_overdraw);
+
+} // namespace game
+
+#endif // MESH_OPTIMIZER_H_
@@ -0,0 +1,200 @@
+#include <charconv>
+#include <stdexcept>
+
+#include "model_loader.h"
+#include "mapped_file.h"
+
+namespace game {
+
+// Parsing state for one OBJ file
+// Tokens are read in place from the mapped file: nothing is copied and no
+// strings are allocated
+struct ObjReader {
+    const char *pos;
+    const char *end;
+    const char *filename;
+    int line;
+};
+
+
+static void ObjError(const ObjReader &reader, const char *message){
+
+    throw(std::ios_base::failure(std::string(reader.filename)+std::string(":")+num_to_str<int>(reader.line)+std::string(": ")+std::string(message)));
+}
+
+
+static inline bool IsBlank(char c){
+
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+
+static inline void SkipBlanks(ObjReader &reader){
+
+    while ((reader.pos < reader.end) && IsBlank(*reader.pos)){
+        reader.pos++;
+    }
+}
+
+
+static inline bool AtLineEnd(const ObjReader &reader){
+
+    return (reader.pos >= reader.end) || (*reader.pos == '\n');
+}
+
+
+// Move to the start of the next line
+static inline void SkipLine(ObjReader &reader){
+
+    while ((reader.pos < reader.end) && (*reader.pos != '\n')){
+        reader.pos++;
+    }
+    if (reader.pos < reader.end){
+        reader.pos++;
+    }
+    reader.line++;
+}
+
+
+// Read a float preceded by blanks; returns false if there is none
+static inline bool ReadFloat(ObjReader &reader, float &value){
+
+    SkipBlanks(reader);
+    // from_chars does not accept a leading '+'
+    if ((reader.pos < reader.end) && (*reader.pos == '+')){
+        reader.pos++;
+    }
+    std::from_chars_result result = std::from_chars(reader.pos, reader.end, value);
+    if (result.ec != std::errc()){
+        return false;
+    }
+    reader.pos = result.ptr;
+    return true;
+}
+
+
+// Read a 1-based (or negative, relative to the end) index and convert it
+// to a 0-based index into an array of the given size; relative indices
+// before the start of the array are rejected here, since a negative result
+// would read as a missing index
+static inline bool ReadIndex(ObjReader &reader, size_t size, int &index){
+
+    int value;
+    std::from_chars_result result = std::from_chars(reader.pos, reader.end, value);
+    if ((result.ec != std::errc()) || (value == 0) || (value < -(int) size)){
+        return false;
+    }
+    reader.pos = result.ptr;
+    index = (value > 0) ? value - 1 : (int) size + value;
+    return true;
+}
+
+
+// Read a face vertex: v, v/vt, v//vn or v/vt/vn
+static inline void ReadFaceVertex(ObjReader &reader, const TriMesh &mesh, int &i, int &t, int &n){
+
+    t = -1;
+    n = -1;
+    if (!ReadIndex(reader, mesh.position.size(), i)){
+        ObjError(reader, "Error: f parameter should have 1, 2, or 3 parameters separated by '/'");
+    }
+    if ((reader.pos >= reader.end) || (*reader.pos != '/')){
+        return;
+    }
+    reader.pos++;
+    if ((reader.pos < reader.end) && (*reader.pos != '/')){
+        if (!ReadIndex(reader, mesh.tex_coord.size(), t)){
+            ObjError(reader, "Error: invalid texture coordinate index in f command");
+        }
+    }
+    if ((reader.pos >= reader.end) || (*reader.pos != '/')){
+        return;
+    }
+    reader.pos++;
+    if (!ReadIndex(reader, mesh.normal.size(), n)){
+        ObjError(reader, "Error: invalid normal index in f command");
+    }
+}
+
+
+void LoadObj(const std::string &filename, TriMesh &mesh){
+
+    MappedFile file(filename);
+
+    ObjReader reader;
+    reader.pos = file.GetData();
+    reader.end = file.GetData() + file.GetSize();
+    reader.filename = filename.c_str();
+    reader.line = 1;
+
+    while (reader.pos < reader.end){
+        SkipBlanks(reader);
+        // Ignore empty lines and comments
+        if (AtLineEnd(reader) || (*reader.pos == '#')){
+            SkipLine(reader);
+            continue;
+        }
+
+        // Command
+        const char *command = reader.pos;
+        while (!AtLineEnd(reader) && !IsBlank(*reader.pos)){
+            reader.pos++;
+        }
+        size_t length = reader.pos - command;
+
+        if ((length == 1) && (command[0] == 'v')){
+            glm::vec3 position;
+            if (!ReadFloat(reader, position.x) || !ReadFloat(reader, position.y) || !ReadFloat(reader, position.z)){
+                ObjError(reader, "Error: v command should have exactly 3 parameters");
+            }
+            mesh.position.push_back(position);
+        } else if ((length == 2) && (command[0] == 'v') && (command[1] == 'n')){
+            glm::vec3 normal;
+            if (!ReadFloat(reader, normal.x) || !ReadFloat(reader, normal.y) || !ReadFloat(reader, normal.z)){
+                ObjError(reader, "Error: vn command should have exactly 3 parameters");
+            }
+            mesh.normal.push_back(normal);
+        } else if ((length == 2) && (command[0] == 'v') && (command[1] == 't')){
+            glm::vec2 tex_coord;
+            if (!ReadFloat(reader, tex_coord.x) || !ReadFloat(reader, tex_coord.y)){
+                ObjError(reader, "Error: vt command should have exactly 2 parameters");
+            }
+            mesh.tex_coord.push_back(tex_coord);
+        } else if ((length == 1) && (command[0] == 'f')){
+            Quad quad;
+            int count = 0;
+            while (true){
+                SkipBlanks(reader);
+                if (AtLineEnd(reader)){
+                    break;
+                }
+                if (count == 4){
+                    ObjError(reader, "Error: f commands with more than 4 vertices not supported");
+                }
+                ReadFaceVertex(reader, mesh, quad.i[count], quad.t[count], quad.n[count]);
+                count++;
+            }
+            if (count < 3){
+                ObjError(reader, "Error: f command should have 3 or 4 parameters");
+            }
+
+            Face face;
+            for (int j = 0; j < 3; j++){
+                face.i[j] = quad.i[j]; face.n[j] = quad.n[j]; face.t[j] = quad.t[j];
+            }
+            mesh.face.push_back(face);
+            // Break a quad into two triangles
+            if (count == 4){
+                int corner[3] = {0, 2, 3};
+                for (int j = 0; j < 3; j++){
+                    face.i[j] = quad.i[corner[j]]; face.n[j] = quad.n[corner[j]]; face.t[j] = quad.t[corner[j]];
+                }
+                mesh.face.push_back(face);
+            }
+        }
+        // Ignore the rest of the line, including other commands
+        SkipLine(reader);
+    }
+}
+
+} // namespace game
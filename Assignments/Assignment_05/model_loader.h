@@ -3,7 +3,7 @@
 
 #include <exception>
 #include <string>
-#include <fstream>
+#include <vector>
 #include <sstream>
 #define GLEW_STATIC
 #include <GL/glew.h>
@@ -36,20 +36,20 @@ struct TriMesh {
     std::vector<Face> face;
 };
 
+// Load an OBJ file (v, vt, vn, and triangle or quad f commands) into mesh;
+// throws std::ios_base::failure if the file cannot be read or parsed
+void LoadObj(const std::string &filename, TriMesh &mesh);
+
 // Helper functions 
-// Trim any character in to_trim from the beginning and end of str
-void string_trim(std::string str, std::string to_trim);
-// Split string into substrings according to characters in separator
-std::vector<std::string> string_split(std::string str, std::string separator);
-// Split string into substrings according to characters in separator. A
-// split is performed when one separator character is found, rather than
-// a sequence of separators
-std::vector<std::string> string_split_once(std::string str, std::string separator);
 // Print a mesh stored internally
 void print_mesh(TriMesh &mesh);
-// Conversion between strings and numbers
-template <typename T> std::string num_to_str(T num);
-template <typename T> T str_to_num(const std::string &str);
+// Conversion from numbers to strings
+template <typename T> std::string num_to_str(T num){
+
+    std::ostringstream ss;
+    ss << num;
+    return ss.str();
+}
 
 } // namespace game;
 
@@ -0,0 +1,158 @@
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+#include "program_cache.h"
+#include "mapped_file.h"
+#include "hash.h"
+
+// Identification of cache files; change the version when the layout
+// changes, or when programs are linked differently (e.g., new attribute
+// bindings), since the binary includes the result of linking
+#define PROGRAM_CACHE_MAGIC "PRGC"
+#define PROGRAM_CACHE_VERSION 1
+
+namespace game {
+
+static_assert(sizeof(ProgramCacheHeader) == 24, "unexpected program cache header size");
+
+
+bool IsProgramBinarySupported(void){
+
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary){
+        return false;
+    }
+    // Some drivers support the functions without any format
+    GLint num_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+    return num_formats > 0;
+}
+
+
+uint64_t GetProgramKey(const std::string source[3]){
+
+    uint64_t hash = HASH_SEED;
+    for (int i = 0; i < 3; i++){
+        // Hash the length too, so that moving text from one source to the
+        // next changes the key
+        uint64_t length = source[i].size();
+        hash = HashBytes(&length, sizeof(length), hash);
+        hash = HashBytes(source[i].data(), source[i].size(), hash);
+    }
+
+    // Binaries only work with the driver that built them
+    const GLenum driver_string[3] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (int i = 0; i < 3; i++){
+        const char *value = (const char *) glGetString(driver_string[i]);
+        if (value){
+            hash = HashBytes(value, strlen(value) + 1, hash);
+        }
+    }
+    return hash;
+}
+
+
+GLuint LoadProgramBinary(const std::string &filename, uint64_t key){
+
+    if (!IsProgramBinarySupported()){
+        return 0;
+    }
+
+    MappedFile *file;
+    try {
+        file = new MappedFile(filename);
+    }
+    catch (std::ios_base::failure &){
+        // No cache yet
+        return 0;
+    }
+
+    // Check that the cache is complete and matches the key
+    GLuint program = 0;
+    const ProgramCacheHeader *header = (const ProgramCacheHeader *) file->GetData();
+    if ((file->GetSize() >= sizeof(ProgramCacheHeader)) &&
+        (memcmp(header->magic, PROGRAM_CACHE_MAGIC, 4) == 0) &&
+        (header->version == PROGRAM_CACHE_VERSION) &&
+        (header->key == key) &&
+        (file->GetSize() == sizeof(ProgramCacheHeader) + header->length)){
+
+        program = glCreateProgram();
+        glProgramBinary(program, (GLenum) header->format, file->GetData() + sizeof(ProgramCacheHeader), (GLsizei) header->length);
+
+        // The driver may reject the binary; then compile again
+        GLint status;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE){
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    delete file;
+    return program;
+}
+
+
+void SetProgramBinaryRetrievable(GLuint program){
+
+    if (IsProgramBinarySupported()){
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+
+bool SaveProgramBinary(const std::string &filename, uint64_t key, GLuint program){
+
+    if (!IsProgramBinarySupported()){
+        return false;
+    }
+
+    // Retrieve the binary
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0){
+        return false;
+    }
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, &binary[0]);
+    if (length <= 0){
+        return false;
+    }
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.format = (uint32_t) format;
+    header.length = (uint32_t) length;
+
+    // Write to a temporary file and rename it, so that a partly written
+    // cache is never picked up
+    std::string temp_filename = filename + std::string(".tmp");
+    std::ofstream f(temp_filename.c_str(), std::ios::binary | std::ios::trunc);
+    if (f.fail()){
+        return false;
+    }
+    f.write((const char *) &header, sizeof(header));
+    f.write(&binary[0], length);
+    f.close();
+    if (f.fail()){
+        std::remove(temp_filename.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_filename, filename, error);
+    if (error){
+        std::remove(temp_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace game
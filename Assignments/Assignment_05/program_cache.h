@@ -0,0 +1,49 @@
+#ifndef PROGRAM_CACHE_H_
+#define PROGRAM_CACHE_H_
+
+#include <string>
+#include <cstdint>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Appended to the prefix of a material's shader files to name the cache of
+// its linked program
+#define PROGRAM_CACHE_EXTENSION ".programcache"
+
+namespace game {
+
+    // Linked shader programs saved by the driver (program binaries), so
+    // that later runs can skip compiling and linking
+    // Layout: ProgramCacheHeader, then the binary. A binary is only used
+    // with the sources and driver it was built with, which the key
+    // identifies; the driver may still reject it (e.g., after an update),
+    // and then the program is compiled again
+    struct ProgramCacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format; // Binary format chosen by the driver
+        uint32_t length; // Size of the binary in bytes
+    };
+
+    // Whether the driver can save and load program binaries
+    bool IsProgramBinarySupported(void);
+
+    // Key of the program built from the vertex, fragment and geometry
+    // program sources by the current driver
+    uint64_t GetProgramKey(const std::string source[3]);
+
+    // Create a program from the cache file if it holds a binary for key
+    // that the driver accepts; returns 0 otherwise
+    GLuint LoadProgramBinary(const std::string &filename, uint64_t key);
+
+    // Ask the driver to keep the binary of a program; call before linking
+    void SetProgramBinaryRetrievable(GLuint program);
+
+    // Save the binary of a linked program; returns false if it could not
+    // be saved (e.g., read-only directory)
+    bool SaveProgramBinary(const std::string &filename, uint64_t key, GLuint program);
+
+} // namespace game
+
+#endif // PROGRAM_CACHE_H_
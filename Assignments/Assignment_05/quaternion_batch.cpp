@@ -0,0 +1,146 @@
+#include <stdexcept>
+#include <string>
+
+#include "quaternion_batch.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define QUATERNION_BATCH_AVX
+#endif
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define QUATERNION_BATCH_SSE
+#endif
+
+namespace game {
+
+// The kernels read quaternions as four packed floats (x, y, z, w), which is
+// how glm stores them
+static_assert(sizeof(glm::quat) == 4*sizeof(float), "glm::quat must be four packed floats");
+
+// Product q*p of quaternions stored as (x, y, z, w):
+//   x = qw*px + qx*pw + qy*pz - qz*py
+//   y = qw*py - qx*pz + qy*pw + qz*px
+//   z = qw*pz + qx*py - qy*px + qz*pw
+//   w = qw*pw - qx*px - qy*py - qz*pz
+// Each column is a lane permutation of p with a sign pattern, multiplied by
+// one component of q broadcast to all lanes
+
+#ifdef QUATERNION_BATCH_SSE
+// One quaternion per register
+static inline __m128 MultiplyNormalize(__m128 q, __m128 p){
+
+    const __m128 sign_x = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f); // (+, -, +, -)
+    const __m128 sign_y = _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f); // (+, +, -, -)
+    const __m128 sign_z = _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f); // (-, +, +, -)
+
+    __m128 px = _mm_xor_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 1, 2, 3)), sign_x); // (pw, pz, py, px)
+    __m128 py = _mm_xor_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 0, 3, 2)), sign_y); // (pz, pw, px, py)
+    __m128 pz = _mm_xor_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1)), sign_z); // (py, px, pw, pz)
+
+    __m128 r = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 3, 3, 3)), p);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(0, 0, 0, 0)), px));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(1, 1, 1, 1)), py));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 2, 2, 2)), pz));
+
+    // Normalize: sum the squares into every lane
+    __m128 sq = _mm_mul_ps(r, r);
+    sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+    sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_div_ps(r, _mm_sqrt_ps(sq));
+}
+#endif
+
+#ifdef QUATERNION_BATCH_AVX
+// Two quaternions per register; the permutations stay within each
+// 128-bit half, so the computation mirrors the SSE version
+static inline __m256 MultiplyNormalize(__m256 q, __m256 p){
+
+    const __m256 sign_x = _mm256_set_ps(-0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f);
+    const __m256 sign_y = _mm256_set_ps(-0.0f, -0.0f, 0.0f, 0.0f, -0.0f, -0.0f, 0.0f, 0.0f);
+    const __m256 sign_z = _mm256_set_ps(-0.0f, 0.0f, 0.0f, -0.0f, -0.0f, 0.0f, 0.0f, -0.0f);
+
+    __m256 px = _mm256_xor_ps(_mm256_permute_ps(p, _MM_SHUFFLE(0, 1, 2, 3)), sign_x);
+    __m256 py = _mm256_xor_ps(_mm256_permute_ps(p, _MM_SHUFFLE(1, 0, 3, 2)), sign_y);
+    __m256 pz = _mm256_xor_ps(_mm256_permute_ps(p, _MM_SHUFFLE(2, 3, 0, 1)), sign_z);
+
+    __m256 r = _mm256_mul_ps(_mm256_permute_ps(q, _MM_SHUFFLE(3, 3, 3, 3)), p);
+    r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(q, _MM_SHUFFLE(0, 0, 0, 0)), px));
+    r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(q, _MM_SHUFFLE(1, 1, 1, 1)), py));
+    r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(q, _MM_SHUFFLE(2, 2, 2, 2)), pz));
+
+    __m256 sq = _mm256_mul_ps(r, r);
+    sq = _mm256_add_ps(sq, _mm256_permute_ps(sq, _MM_SHUFFLE(2, 3, 0, 1)));
+    sq = _mm256_add_ps(sq, _mm256_permute_ps(sq, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm256_div_ps(r, _mm256_sqrt_ps(sq));
+}
+#endif
+
+
+void RotateQuaternions(glm::quat *orientation, const glm::quat *rotation, int count){
+
+#if defined(QUATERNION_BATCH_AVX)
+    RotateQuaternions(orientation, rotation, count, AVXQuaternionKernel);
+#elif defined(QUATERNION_BATCH_SSE)
+    RotateQuaternions(orientation, rotation, count, SSEQuaternionKernel);
+#else
+    RotateQuaternions(orientation, rotation, count, ScalarQuaternionKernel);
+#endif
+}
+
+
+void RotateQuaternions(glm::quat *orientation, const glm::quat *rotation, int count, QuaternionKernel kernel){
+
+    if (!HasQuaternionKernel(kernel)){
+        throw(std::invalid_argument(std::string("Quaternion kernel not compiled in")));
+    }
+
+    float *q = (float *) orientation;
+    const float *p = (const float *) rotation;
+    int i = 0;
+
+#ifdef QUATERNION_BATCH_AVX
+    if (kernel == AVXQuaternionKernel){
+        for (; i + 2 <= count; i += 2){
+            __m256 r = MultiplyNormalize(_mm256_loadu_ps(q + 4*i), _mm256_loadu_ps(p + 4*i));
+            _mm256_storeu_ps(q + 4*i, r);
+        }
+    }
+#endif
+
+#ifdef QUATERNION_BATCH_SSE
+    // Also rotates the last quaternion of an odd count for AVX
+    if (kernel != ScalarQuaternionKernel){
+        for (; i < count; i++){
+            __m128 r = MultiplyNormalize(_mm_loadu_ps(q + 4*i), _mm_loadu_ps(p + 4*i));
+            _mm_storeu_ps(q + 4*i, r);
+        }
+    }
+#endif
+
+    for (; i < count; i++){
+        orientation[i] *= rotation[i];
+        orientation[i] = glm::normalize(orientation[i]);
+    }
+}
+
+
+bool HasQuaternionKernel(QuaternionKernel kernel){
+
+    if (kernel == ScalarQuaternionKernel){
+        return true;
+    }
+#ifdef QUATERNION_BATCH_SSE
+    if (kernel == SSEQuaternionKernel){
+        return true;
+    }
+#endif
+#ifdef QUATERNION_BATCH_AVX
+    if (kernel == AVXQuaternionKernel){
+        return true;
+    }
+#endif
+    return false;
+}
+
+} // namespace game
@@ -0,0 +1,28 @@
+#ifndef QUATERNION_BATCH_H_
+#define QUATERNION_BATCH_H_
+
+#include <glm/glm.hpp>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/quaternion.hpp>
+
+namespace game {
+
+// Batched quaternion operations over packed arrays
+// Uses AVX or SSE when the compiler targets them, and plain glm otherwise
+
+// Implementations of the kernels
+typedef enum QuaternionKernels { ScalarQuaternionKernel, SSEQuaternionKernel, AVXQuaternionKernel } QuaternionKernel;
+
+// Rotate every orientation by its rotation, as SceneNode::Rotate does:
+// orientation[i] = normalize(orientation[i] * rotation[i])
+// Uses the widest kernel compiled in
+void RotateQuaternions(glm::quat *orientation, const glm::quat *rotation, int count);
+// Same with the given kernel, e.g., to compare the kernels; throws
+// std::invalid_argument if the kernel was not compiled in
+void RotateQuaternions(glm::quat *orientation, const glm::quat *rotation, int count, QuaternionKernel kernel);
+// Whether a kernel was compiled in (AVX needs USE_AVX, SSE an x86 target)
+bool HasQuaternionKernel(QuaternionKernel kernel);
+
+} // namespace game
+
+#endif // QUATERNION_BATCH_H_
@@ -0,0 +1,154 @@
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+#include "random.h"
+
+// Philox4x32 multipliers and key increments (Salmon et al., "Parallel
+// random numbers: as easy as 1, 2, 3", 2011)
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+namespace game {
+
+// Convert 32 random bits to a float in [0, 1), using the 24 bits a float
+// can represent exactly
+static inline float ToUnit(uint32_t x){
+
+    return (float) (x >> 8) * (1.0f / 16777216.0f);
+}
+
+
+Random::Random(uint64_t seed, uint32_t stream){
+
+    key_[0] = (uint32_t) seed;
+    key_[1] = (uint32_t) (seed >> 32);
+    stream_ = stream;
+    Seek(0);
+}
+
+
+void Random::Seek(uint64_t block){
+
+    block_ = block;
+    next_ = 4;
+}
+
+
+void Random::Generate(uint64_t block, uint32_t value[4]) const {
+
+    // The counter holds the block index and the stream
+    uint32_t c0 = (uint32_t) block;
+    uint32_t c1 = (uint32_t) (block >> 32);
+    uint32_t c2 = stream_;
+    uint32_t c3 = 0;
+    uint32_t k0 = key_[0];
+    uint32_t k1 = key_[1];
+
+    for (int r = 0; r < PHILOX_ROUNDS; r++){
+        uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+        c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t) p1;
+        c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t) p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    value[0] = c0;
+    value[1] = c1;
+    value[2] = c2;
+    value[3] = c3;
+}
+
+
+uint32_t Random::NextUInt(void){
+
+    if (next_ == 4){
+        Generate(block_++, buffer_);
+        next_ = 0;
+    }
+    return buffer_[next_++];
+}
+
+
+float Random::Uniform(void){
+
+    return ToUnit(NextUInt());
+}
+
+
+float Random::Uniform(float min, float max){
+
+    return min + (max - min) * Uniform();
+}
+
+
+void Random::Uniform(float *value, int count){
+
+    // Use up the current block, then convert whole blocks at once
+    int i = 0;
+    while ((i < count) && (next_ < 4)){
+        value[i++] = ToUnit(buffer_[next_++]);
+    }
+    uint32_t block[4];
+    for (; i + 4 <= count; i += 4){
+        Generate(block_++, block);
+        for (int k = 0; k < 4; k++){
+            value[i + k] = ToUnit(block[k]);
+        }
+    }
+    for (; i < count; i++){
+        value[i] = Uniform();
+    }
+}
+
+
+glm::vec3 Random::Sphere(void){
+
+    float u = Uniform();
+    float v = Uniform();
+    return SphereFromUniform(u, v);
+}
+
+
+glm::vec2 Random::Disk(void){
+
+    float u = Uniform();
+    float v = Uniform();
+    return DiskFromUniform(u, v);
+}
+
+
+void Random::UniformBlock(uint64_t block, float value[4]) const {
+
+    uint32_t bits[4];
+    Generate(block, bits);
+    for (int k = 0; k < 4; k++){
+        value[k] = ToUnit(bits[k]);
+    }
+}
+
+
+glm::vec3 Random::SphereFromUniform(float u, float v){
+
+    // The height is uniform over the sphere (Archimedes), so no arc cosine
+    // is needed to spread the points evenly
+    float theta = u * 2.0f * glm::pi<float>();
+    float z = 2.0f * v - 1.0f;
+    float r = sqrt(glm::max(0.0f, 1.0f - z*z));
+    return glm::vec3(r*cos(theta), r*sin(theta), z);
+}
+
+
+glm::vec2 Random::DiskFromUniform(float u, float v){
+
+    float theta = u * 2.0f * glm::pi<float>();
+    float r = sqrt(v);
+    return glm::vec2(r*cos(theta), r*sin(theta));
+}
+
+} // namespace game
@@ -0,0 +1,65 @@
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Seed used for all generated content unless another one is given, so that
+// every run builds the same scene
+#define RANDOM_DEFAULT_SEED 0x5EED5EED5EED5EEDull
+
+namespace game {
+
+    // Independent random streams of the parts of the game that draw random
+    // numbers, so that changing how many numbers one of them draws does
+    // not change what the others get
+    typedef enum RandomStreams { SphereParticleStream, FireParticleStream, RingParticleStream, AsteroidStream, FireworkStream } RandomStream;
+
+    // Counter-based random number generator (Philox4x32-10)
+    // Each block of four numbers is a pure function of the seed, the stream
+    // and the index of the block, so any part of a stream can be computed
+    // directly: threads can fill disjoint ranges of an array with the same
+    // numbers a serial loop would produce, without sharing any state
+    class Random {
+
+        public:
+            Random(uint64_t seed = RANDOM_DEFAULT_SEED, uint32_t stream = 0);
+
+            // Continue the stream from the block with the given index
+            void Seek(uint64_t block);
+
+            // Next number of the stream
+            uint32_t NextUInt(void);
+            // Uniform number in [0, 1) or [min, max)
+            float Uniform(void);
+            float Uniform(float min, float max);
+            // Fill an array with uniform numbers in [0, 1), four per block
+            void Uniform(float *value, int count);
+            // Uniform point on the unit sphere and in the unit disk
+            glm::vec3 Sphere(void);
+            glm::vec2 Disk(void);
+
+            // The four uniform numbers in [0, 1) of a block, leaving the
+            // position in the stream unchanged
+            void UniformBlock(uint64_t block, float value[4]) const;
+
+            // Map uniform numbers u, v in [0, 1) to a point on the unit
+            // sphere (u sets the longitude, v the height) and in the unit
+            // disk (u sets the angle, v the squared distance to the center)
+            static glm::vec3 SphereFromUniform(float u, float v);
+            static glm::vec2 DiskFromUniform(float u, float v);
+
+        private:
+            uint32_t key_[2]; // Seed
+            uint32_t stream_;
+            uint64_t block_; // Index of the next block
+            uint32_t buffer_[4]; // Current block
+            int next_; // Next number of the current block
+
+            void Generate(uint64_t block, uint32_t value[4]) const;
+
+    }; // class Random
+
+} // namespace game
+
+#endif // RANDOM_H_
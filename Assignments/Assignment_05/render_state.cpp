@@ -0,0 +1,112 @@
+#include "render_state.h"
+
+namespace game {
+
+RenderState::RenderState(void){
+
+    Reset(1);
+}
+
+
+RenderState::~RenderState(){
+}
+
+
+void RenderState::Reset(int effect_num){
+
+    effect_num_ = effect_num;
+    // Zero is never used by a node, so the first node sets all bindings
+    blending_known_ = false;
+    blending_ = false;
+    program_ = 0;
+    texture_ = 0;
+    sampler_known_ = false;
+    sampler_ = 0;
+    vertex_array_ = 0;
+    state_changes_ = 0;
+}
+
+
+void RenderState::SetBlending(bool blending){
+
+    if (blending_known_ && blending == blending_){
+        return;
+    }
+
+    if (blending){
+        // Disable z-buffer
+        glDisable(GL_DEPTH_TEST);
+        // Enable blending
+        glEnable(GL_BLEND);
+
+        if (effect_num_ == 3){
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // Simpler form
+        } else {
+            glBlendFuncSeparate(GL_SRC_ALPHA, GL_DST_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+
+        glBlendEquationSeparate(GL_FUNC_ADD, GL_MIN);
+    } else {
+        // Enable z-buffer
+        glDisable(GL_BLEND);
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+    }
+
+    blending_known_ = true;
+    blending_ = blending;
+    state_changes_++;
+}
+
+
+bool RenderState::UseProgram(GLuint program){
+
+    if (program == program_){
+        return false;
+    }
+
+    glUseProgram(program);
+    program_ = program;
+    state_changes_++;
+    return true;
+}
+
+
+void RenderState::BindTexture(GLuint texture, GLuint sampler){
+
+    if (texture != texture_){
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        texture_ = texture;
+        state_changes_++;
+    }
+
+    // Without sampler objects, every texture has sampler 0 and filters
+    // with its own parameters
+    if ((!sampler_known_ || sampler != sampler_) && (GLEW_VERSION_3_3 || GLEW_ARB_sampler_objects)){
+        glBindSampler(0, sampler);
+        sampler_known_ = true;
+        sampler_ = sampler;
+        state_changes_++;
+    }
+}
+
+
+void RenderState::BindVertexArray(GLuint vertex_array){
+
+    if (vertex_array == vertex_array_){
+        return;
+    }
+
+    glBindVertexArray(vertex_array);
+    vertex_array_ = vertex_array;
+    state_changes_++;
+}
+
+
+int RenderState::GetStateChanges(void) const {
+
+    return state_changes_;
+}
+
+} // namespace game
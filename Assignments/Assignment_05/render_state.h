@@ -0,0 +1,52 @@
+#ifndef RENDER_STATE_H_
+#define RENDER_STATE_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+namespace game {
+
+    // Tracks the OpenGL state set while drawing the scene, so that nodes
+    // only issue the state changes that differ from the previous node
+    class RenderState {
+
+        public:
+            RenderState(void);
+            ~RenderState();
+
+            // Forget the current state at the start of a pass, since other
+            // code may have changed it; effect_num selects the blending
+            // function
+            void Reset(int effect_num);
+
+            // Enable blending (and disable the z-buffer) or the reverse
+            void SetBlending(bool blending);
+            // Select a shader program; returns true if it was not already
+            // current, so that per-program inputs need to be set
+            bool UseProgram(GLuint program);
+            // Bind a texture and the sampler object that filters it to the
+            // first texture unit
+            void BindTexture(GLuint texture, GLuint sampler = 0);
+            // Bind a vertex array
+            void BindVertexArray(GLuint vertex_array);
+
+            // Number of state changes issued since the last reset
+            int GetStateChanges(void) const;
+
+        private:
+            int effect_num_; // Screen-space effect, selects blending function
+            bool blending_known_; // Blending was set since the last reset
+            bool blending_;
+            GLuint program_;
+            GLuint texture_;
+            bool sampler_known_; // Sampler was bound since the last reset
+            GLuint sampler_;
+            GLuint vertex_array_;
+            int state_changes_;
+
+    }; // class RenderState
+
+} // namespace game
+
+#endif // RENDER_STATE_H_
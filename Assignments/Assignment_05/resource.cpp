@@ -7,17 +7,50 @@ namespace game {
 Resource::Resource(ResourceType type, std::string name, GLuint resource, GLsizei size){
     type_ = type;
     name_ = name;
+    ready_ = true;
     resource_ = resource;
     size_ = size;
+    vertex_format_ = FullVertexFormat;
+    bounding_radius_ = -1.0;
+    acmr_before_ = -1.0;
+    acmr_after_ = -1.0;
+    sampler_ = 0;
+
+    if (type_ == Material){
+        SetupLocations();
+    }
 }
 
 
-Resource::Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size){
+Resource::Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLuint vertex_array, GLsizei size, VertexFormatType vertex_format){
     type_ = type;
     name_ = name;
+    ready_ = true;
     array_buffer_ = array_buffer;
     element_array_buffer_ = element_array_buffer;
+    vertex_array_ = vertex_array;
     size_ = size;
+    vertex_format_ = vertex_format;
+    bounding_radius_ = -1.0;
+    acmr_before_ = -1.0;
+    acmr_after_ = -1.0;
+    sampler_ = 0;
+}
+
+
+Resource::Resource(ResourceType type, std::string name, VertexFormatType vertex_format){
+    type_ = type;
+    name_ = name;
+    ready_ = false;
+    array_buffer_ = 0;
+    element_array_buffer_ = 0;
+    vertex_array_ = 0;
+    size_ = 0;
+    vertex_format_ = vertex_format;
+    bounding_radius_ = -1.0;
+    acmr_before_ = -1.0;
+    acmr_after_ = -1.0;
+    sampler_ = 0;
 }
 
 
@@ -26,6 +59,33 @@ Resource::~Resource(){
 }
 
 
+bool Resource::IsReady(void) const {
+
+    return ready_;
+}
+
+
+void Resource::SetResource(GLuint resource){
+
+    resource_ = resource;
+    if (type_ == Material){
+        location_.clear();
+        SetupLocations();
+    }
+    ready_ = true;
+}
+
+
+void Resource::SetGeometry(GLuint array_buffer, GLuint element_array_buffer, GLuint vertex_array, GLsizei size){
+
+    array_buffer_ = array_buffer;
+    element_array_buffer_ = element_array_buffer;
+    vertex_array_ = vertex_array;
+    size_ = size;
+    ready_ = true;
+}
+
+
 ResourceType Resource::GetType(void) const {
 
     return type_;
@@ -44,6 +104,18 @@ GLuint Resource::GetResource(void) const {
 }
 
 
+void Resource::SetSampler(GLuint sampler){
+
+    sampler_ = sampler;
+}
+
+
+GLuint Resource::GetSampler(void) const {
+
+    return sampler_;
+}
+
+
 GLuint Resource::GetArrayBuffer(void) const {
 
     return array_buffer_;
@@ -56,9 +128,156 @@ GLuint Resource::GetElementArrayBuffer(void) const {
 }
 
 
+GLuint Resource::GetVertexArray(void) const {
+
+    return vertex_array_;
+}
+
+
 GLsizei Resource::GetSize(void) const {
 
     return size_;
 }
 
+
+VertexFormatType Resource::GetVertexFormat(void) const {
+
+    return vertex_format_;
+}
+
+
+void Resource::SetBounds(glm::vec3 center, float radius){
+
+    bounding_center_ = center;
+    bounding_radius_ = radius;
+}
+
+
+bool Resource::HasBounds(void) const {
+
+    return bounding_radius_ >= 0.0;
+}
+
+
+glm::vec3 Resource::GetBoundingCenter(void) const {
+
+    return bounding_center_;
+}
+
+
+float Resource::GetBoundingRadius(void) const {
+
+    return bounding_radius_;
+}
+
+
+void Resource::SetACMR(float before, float after){
+
+    acmr_before_ = before;
+    acmr_after_ = after;
+}
+
+
+bool Resource::HasACMR(void) const {
+
+    return acmr_after_ >= 0.0;
+}
+
+
+float Resource::GetACMRBefore(void) const {
+
+    return acmr_before_;
+}
+
+
+float Resource::GetACMRAfter(void) const {
+
+    return acmr_after_;
+}
+
+
+void Resource::AddLevelOfDetail(const Resource *level){
+
+    level_of_detail_.push_back(level);
+}
+
+
+int Resource::GetNumLevelsOfDetail(void) const {
+
+    return (int) level_of_detail_.size() + 1;
+}
+
+
+const Resource *Resource::GetLevelOfDetail(int level) const {
+
+    if (level <= 0){
+        return this;
+    }
+    return level_of_detail_[level - 1];
+}
+
+
+GLint Resource::GetLocation(const std::string &name) const {
+
+    std::unordered_map<std::string, GLint>::const_iterator it = location_.find(name);
+    if (it == location_.end()){
+        return -1;
+    }
+    return it->second;
+}
+
+
+const MaterialLocations &Resource::GetLocations(void) const {
+
+    return material_locations_;
+}
+
+
+void Resource::SetupLocations(void){
+
+    GLint count, max_length;
+    GLint size;
+    GLenum type;
+
+    // Attributes (bound to fixed locations, but kept for reference)
+    glGetProgramiv(resource_, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(resource_, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+    std::string buffer(max_length + 1, '\0');
+    for (GLint i = 0; i < count; i++){
+        GLsizei length;
+        glGetActiveAttrib(resource_, i, (GLsizei) buffer.size(), &length, &size, &type, &buffer[0]);
+        std::string name(buffer.c_str(), length);
+        location_[name] = glGetAttribLocation(resource_, name.c_str());
+    }
+
+    // Uniforms
+    glGetProgramiv(resource_, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(resource_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    buffer.assign(max_length + 1, '\0');
+    for (GLint i = 0; i < count; i++){
+        GLsizei length;
+        glGetActiveUniform(resource_, i, (GLsizei) buffer.size(), &length, &size, &type, &buffer[0]);
+        std::string name(buffer.c_str(), length);
+        // Arrays are reported as "name[0]"; store them under "name"
+        std::string::size_type bracket = name.find('[');
+        if (bracket != std::string::npos){
+            name = name.substr(0, bracket);
+        }
+        location_[name] = glGetUniformLocation(resource_, name.c_str());
+    }
+
+    // Inputs used on every draw
+    material_locations_.world_mat = GetLocation("world_mat");
+    material_locations_.normal_mat = GetLocation("normal_mat");
+    material_locations_.view_mat = GetLocation("view_mat");
+    material_locations_.projection_mat = GetLocation("projection_mat");
+    material_locations_.texture_map = GetLocation("texture_map");
+    material_locations_.timer = GetLocation("timer");
+    material_locations_.effect_num = GetLocation("effect_num");
+    material_locations_.start = GetLocation("start");
+    material_locations_.end = GetLocation("end");
+    material_locations_.momentum = GetLocation("momentum");
+    material_locations_.object_color = GetLocation("object_color");
+}
+
 } // namespace game
@@ -2,21 +2,54 @@
 #define RESOURCE_H_
 
 #include <string>
+#include <vector>
+#include <unordered_map>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "vertex_format.h"
+
+// Attribute locations bound when linking every material, so that the
+// vertex array of a geometry can be set up once and used with any program
+#define VERTEX_ATTRIBUTE_LOCATION 0
+#define NORMAL_ATTRIBUTE_LOCATION 1
+#define COLOR_ATTRIBUTE_LOCATION 2
+#define UV_ATTRIBUTE_LOCATION 3
+// Per-instance attributes of instanced geometry
+#define INSTANCE_POSITION_ATTRIBUTE_LOCATION 4
+#define INSTANCE_ORIENTATION_ATTRIBUTE_LOCATION 5
+#define INSTANCE_SCALE_ATTRIBUTE_LOCATION 6
 
 namespace game {
 
     // Possible resource types
     typedef enum Type { Material, PointSet, Mesh, Texture } ResourceType;
 
+    // Locations of the shader inputs set by the scene and camera
+    // Inputs that a program does not use have location -1
+    struct MaterialLocations {
+        GLint world_mat;
+        GLint normal_mat;
+        GLint view_mat;
+        GLint projection_mat;
+        GLint texture_map;
+        GLint timer;
+        GLint effect_num;
+        GLint start;
+        GLint end;
+        GLint momentum;
+        GLint object_color;
+    };
+
     // Class that holds one resource
     class Resource {
 
         private:
             ResourceType type_; // Type of resource
             std::string name_; // Reference name
+            bool ready_; // OpenGL objects created (false while loading)
             union {
                 struct {
                     GLuint resource_; // OpenGL handle for resource
@@ -24,20 +57,76 @@ namespace game {
                 struct {
                     GLuint array_buffer_; // Buffers for geometry
                     GLuint element_array_buffer_;
+                    GLuint vertex_array_; // Attribute layout of the buffers
                 };
             };
+            GLuint sampler_; // Filtering of a texture (0 for the texture's own)
             GLsizei size_; // Number of primitives in geometry
+            VertexFormatType vertex_format_; // Vertex layout of geometry
+            // Bounding sphere of geometry in object coordinates; a negative
+            // radius means the geometry has no bounds (e.g., particles
+            // moved by the shaders)
+            glm::vec3 bounding_center_;
+            float bounding_radius_;
+            // Average number of vertex shader runs per triangle of geometry
+            // before and after it was optimized for the vertex cache;
+            // negative if not measured (e.g., loaded from a cache)
+            float acmr_before_;
+            float acmr_after_;
+            // Coarser versions of the geometry, from finest to coarsest
+            std::vector<const Resource *> level_of_detail_;
+            // Shader input locations of a material, queried once when the
+            // resource is created
+            std::unordered_map<std::string, GLint> location_;
+            MaterialLocations material_locations_;
+
+            // Query the locations of all active inputs of a material
+            void SetupLocations(void);
 
         public:
             Resource(ResourceType type, std::string name, GLuint resource, GLsizei size);
-            Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
+            Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLuint vertex_array, GLsizei size, VertexFormatType vertex_format = FullVertexFormat);
+            // Placeholder for a resource still being loaded, with no OpenGL
+            // objects yet
+            Resource(ResourceType type, std::string name, VertexFormatType vertex_format);
             ~Resource();
+            // Whether the OpenGL objects of the resource exist; nodes using
+            // a resource that is not ready are not drawn
+            bool IsReady(void) const;
+            // Give a placeholder its OpenGL objects once loaded: the handle
+            // of a material or texture, or the buffers of a geometry
+            void SetResource(GLuint resource);
+            void SetGeometry(GLuint array_buffer, GLuint element_array_buffer, GLuint vertex_array, GLsizei size);
             ResourceType GetType(void) const;
             const std::string GetName(void) const;
             GLuint GetResource(void) const;
             GLuint GetArrayBuffer(void) const;
             GLuint GetElementArrayBuffer(void) const;
+            GLuint GetVertexArray(void) const;
+            // Sampler object bound with a texture
+            void SetSampler(GLuint sampler);
+            GLuint GetSampler(void) const;
             GLsizei GetSize(void) const;
+            VertexFormatType GetVertexFormat(void) const;
+            // Bounding sphere of geometry
+            void SetBounds(glm::vec3 center, float radius);
+            bool HasBounds(void) const;
+            glm::vec3 GetBoundingCenter(void) const;
+            float GetBoundingRadius(void) const;
+            // Vertex cache efficiency of geometry
+            void SetACMR(float before, float after);
+            bool HasACMR(void) const;
+            float GetACMRBefore(void) const;
+            float GetACMRAfter(void) const;
+            // Levels of detail of geometry: level 0 is this resource, and
+            // each added level is coarser than the previous one
+            void AddLevelOfDetail(const Resource *level);
+            int GetNumLevelsOfDetail(void) const;
+            const Resource *GetLevelOfDetail(int level) const;
+            // Location of a shader input of a material, or -1 if the
+            // program does not use it
+            GLint GetLocation(const std::string &name) const;
+            const MaterialLocations &GetLocations(void) const;
 
     }; // class Resource
 
@@ -4,164 +4,666 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
 #include <SOIL/SOIL.h>
 
 #include "resource_manager.h"
 #include "model_loader.h"
+#include "mesh_cache.h"
+#include "mesh_normals.h"
+#include "mesh_optimizer.h"
+#include "program_cache.h"
+#include "hash.h"
+
+// Fewest samples used for the coarsest levels of detail of generated
+// geometry
+#define MIN_LOD_LOOP_SAMPLES 8
+#define MIN_LOD_CIRCLE_SAMPLES 6
+#define MIN_LOD_THETA_SAMPLES 8
+#define MIN_LOD_PHI_SAMPLES 5
 
 namespace game {
 
+// Vertex of a loaded mesh: indices of its position, normal and texture
+// coordinate
+struct MeshVertexKey {
+    int position;
+    int normal;
+    int tex_coord;
+
+    bool operator==(const MeshVertexKey &other) const {
+        return (position == other.position) && (normal == other.normal) && (tex_coord == other.tex_coord);
+    }
+};
+
+struct MeshVertexKeyHash {
+    size_t operator()(const MeshVertexKey &key) const {
+        // Mix the three indices with large odd multipliers
+        size_t h = (size_t) (unsigned int) key.position * 0x9E3779B1u;
+        h ^= (size_t) (unsigned int) key.normal * 0x85EBCA77u + (h << 6) + (h >> 2);
+        h ^= (size_t) (unsigned int) key.tex_coord * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+        return h;
+    }
+};
+
+
+// Settings of the processing of loaded meshes after parsing, recorded in
+// their caches
+static uint64_t GetMeshOptions(bool angle_weighted_normals, bool optimize_overdraw){
+
+    const uint64_t option[4] = {MESH_NORMALS_VERSION, angle_weighted_normals, MESH_OPTIMIZER_VERSION, optimize_overdraw};
+    return HashBytes(option, sizeof(option));
+}
+
+
+// Optimize a mesh for rendering and measure the average number of vertex
+// shader runs per triangle before and after; returns the new number of
+// vertices
+static GLsizei OptimizeMeshAndMeasure(GLfloat *vertex, int vertex_att, GLsizei num_vertices, GLuint *index, GLsizei num_indices, bool optimize_overdraw, float &acmr_before, float &acmr_after){
+
+    acmr_before = ComputeACMR(index, num_indices, num_vertices);
+    num_vertices = OptimizeMesh(vertex, vertex_att, num_vertices, index, num_indices, optimize_overdraw);
+    acmr_after = ComputeACMR(index, num_indices, num_vertices);
+    return num_vertices;
+}
+
+
+// Let the driver compile shaders on background threads if it can
+static void EnableParallelShaderCompile(void){
+
+#ifdef GL_KHR_parallel_shader_compile
+    static bool enabled = false;
+    if (!enabled && GLEW_KHR_parallel_shader_compile){
+        // As many threads as the driver wants
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+    enabled = true;
+#endif
+}
+
+
+// Whether the driver is done compiling and linking a program, so that its
+// status can be read without waiting; without a background compiler the
+// status is always available (reading it does the work)
+static bool IsProgramReady(GLuint program){
+
+#ifdef GL_KHR_parallel_shader_compile
+    if (GLEW_KHR_parallel_shader_compile){
+        GLint done = GL_TRUE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+#endif
+    return true;
+}
+
+
+// Resource whose files are read (possibly on the loader thread) before its
+// OpenGL objects are created
+struct ResourceManager::PendingLoad {
+    ResourceType type;
+    std::string name;
+    std::string filename; // File name, or prefix of the shader files
+    VertexFormatType vertex_format;
+    bool angle_weighted_normals; // Weighting of computed mesh normals
+    Resource *resource; // Placeholder to complete, or NULL to add a new resource
+    std::string error; // Why reading failed; empty on success
+
+    // Material: vertex, fragment and geometry program sources (the
+    // geometry program is optional and may be empty), then the program
+    // submitted to the driver, its shaders (none if the program came from
+    // the binary cache) and the key of its binary
+    std::string source[3];
+    GLuint program;
+    GLuint shader[3];
+    uint64_t program_key;
+
+    // Texture: decoded image, freed once uploaded
+    unsigned char *image;
+    int width, height, channels;
+
+    // Mesh: vertices and indices, either in the mapped cache file or
+    // in the arrays built from the obj file
+    std::unique_ptr<MeshCache> cache;
+    std::vector<GLfloat> vertex;
+    std::vector<GLuint> index;
+    const GLfloat *vertex_data;
+    GLsizei num_vertices;
+    const GLuint *index_data;
+    GLsizei num_indices;
+    glm::vec3 center;
+    float radius;
+    // Vertex cache efficiency before and after optimizing; negative if
+    // the mesh came from the cache
+    float acmr_before, acmr_after;
+
+    PendingLoad(ResourceType type, const std::string &name, const char *filename, VertexFormatType vertex_format, bool angle_weighted_normals = false)
+        : type(type), name(name), filename(filename), vertex_format(vertex_format), angle_weighted_normals(angle_weighted_normals), resource(NULL),
+          program(0), program_key(0), image(NULL), width(0), height(0), channels(0),
+          vertex_data(NULL), num_vertices(0), index_data(NULL), num_indices(0), radius(-1.0), acmr_before(-1.0), acmr_after(-1.0) {
+        shader[0] = shader[1] = shader[2] = 0;
+    }
+
+    ~PendingLoad(){
+        if (image){
+            SOIL_free_image_data(image);
+        }
+    }
+};
+
+
 ResourceManager::ResourceManager(void){
+
+    load_quit_ = false;
+    num_requested_ = 0;
+    num_completed_ = 0;
+    texture_sampler_ = 0;
 }
 
 
 ResourceManager::~ResourceManager(){
+
+    // Stop the loader thread; requests it did not get to are dropped
+    if (loader_.joinable()){
+        {
+            std::lock_guard<std::mutex> lock(load_mutex_);
+            load_quit_ = true;
+        }
+        load_wake_.notify_all();
+        loader_.join();
+    }
+    for (unsigned int i = 0; i < load_request_.size(); i++){
+        delete load_request_[i];
+    }
+    for (unsigned int i = 0; i < load_done_.size(); i++){
+        delete load_done_[i];
+    }
+    for (unsigned int i = 0; i < load_compiling_.size(); i++){
+        delete load_compiling_[i];
+    }
 }
 
 
-void ResourceManager::AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size){
+Resource *ResourceManager::AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size){
 
     Resource *res;
 
     res = new Resource(type, name, resource, size);
 
-    resource_.push_back(res);
+    RegisterResource(res);
+
+    return res;
 }
 
 
-void ResourceManager::AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size){
+Resource *ResourceManager::AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size, VertexFormatType vertex_format){
 
     Resource *res;
 
-    res = new Resource(type, name, array_buffer, element_array_buffer, size);
+    // Record the vertex layout of the geometry once, so that drawing it
+    // only needs to bind the vertex array
+    GLuint vertex_array = CreateVertexArray(array_buffer, element_array_buffer, vertex_format);
+
+    res = new Resource(type, name, array_buffer, element_array_buffer, vertex_array, size, vertex_format);
+
+    RegisterResource(res);
+
+    return res;
+}
+
+
+GLuint ResourceManager::CreateVertexArray(GLuint array_buffer, GLuint element_array_buffer, VertexFormatType vertex_format){
+
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, array_buffer);
+    SetupVertexAttributes(GetVertexFormat(vertex_format));
+    // The element array binding is part of the vertex array state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
+
+    glBindVertexArray(0);
 
+    return vao;
+}
+
+
+void ResourceManager::RegisterResource(Resource *res){
+
+    // The first resource added under a name keeps it, as with the
+    // original linear search
+    ResourceHandle handle = (ResourceHandle) resource_.size();
     resource_.push_back(res);
+    resource_index_.emplace(res->GetName(), handle);
+}
+
+
+void ResourceManager::LoadResource(ResourceType type, const std::string name, const char *filename, VertexFormatType vertex_format, bool angle_weighted_normals){
+
+    // Read the files and create the resource right away
+    PendingLoad load(type, name, filename, vertex_format, angle_weighted_normals);
+    ReadResource(load);
+    CompleteResource(load);
+}
+
+
+Resource *ResourceManager::LoadResourceAsync(ResourceType type, const std::string name, const char *filename, VertexFormatType vertex_format, bool angle_weighted_normals){
+
+    if ((type != Material) && (type != Texture) && (type != Mesh)){
+        throw(std::invalid_argument(std::string("Invalid type of resource")));
+    }
+
+    // Register a placeholder, so that nodes can refer to the resource
+    // before it is loaded
+    Resource *res = new Resource(type, name, vertex_format);
+    RegisterResource(res);
+
+    PendingLoad *load = new PendingLoad(type, name, filename, vertex_format, angle_weighted_normals);
+    load->resource = res;
+
+    // Start the loader thread on the first request
+    if (!loader_.joinable()){
+        loader_ = std::thread(&ResourceManager::LoaderLoop, this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(load_mutex_);
+        load_request_.push_back(load);
+    }
+    load_wake_.notify_one();
+    num_requested_++;
+
+    return res;
+}
+
+
+int ResourceManager::ProcessLoadedResources(void){
+
+    return CompleteLoads(false);
 }
 
 
-void ResourceManager::LoadResource(ResourceType type, const std::string name, const char *filename){
+void ResourceManager::FinishLoading(void){
+
+    while (num_completed_ < num_requested_){
+        // Wait for the loader thread unless programs are still compiling
+        if (load_compiling_.empty()){
+            std::unique_lock<std::mutex> lock(load_mutex_);
+            load_done_wake_.wait(lock, [this]{ return !load_done_.empty(); });
+        }
+        CompleteLoads(true);
+    }
+}
+
+
+int ResourceManager::CompleteLoads(bool wait){
+
+    // Take one load at a time, so that the remaining ones are still
+    // queued (and freed) if completing a resource throws
+    // Programs are only submitted to the driver here, so that all the
+    // programs read since the last call compile together
+    int count = 0;
+    while (true){
+        std::unique_ptr<PendingLoad> load;
+        {
+            std::lock_guard<std::mutex> lock(load_mutex_);
+            if (load_done_.empty()){
+                break;
+            }
+            load.reset(load_done_.front());
+            load_done_.pop_front();
+        }
+
+        if (!load->error.empty()){
+            num_completed_++;
+            throw(std::ios_base::failure(load->error));
+        }
+        if (load->type == Material){
+            SubmitProgram(*load);
+            load_compiling_.push_back(load.release());
+        } else {
+            num_completed_++;
+            count++;
+            CompleteResource(*load);
+        }
+    }
+
+    // Check the programs the driver is done with; with a background
+    // compiler, the others are checked again on the next call instead of
+    // stalling this frame
+    unsigned int i = 0;
+    while (i < load_compiling_.size()){
+        if (!wait && !IsProgramReady(load_compiling_[i]->program)){
+            i++;
+            continue;
+        }
+        std::unique_ptr<PendingLoad> load(load_compiling_[i]);
+        load_compiling_.erase(load_compiling_.begin() + i);
+        num_completed_++;
+        count++;
+        CompleteResource(*load);
+    }
+
+    return count;
+}
+
+
+int ResourceManager::GetNumRequestedResources(void) const {
+
+    return num_requested_;
+}
+
+
+int ResourceManager::GetNumCompletedResources(void) const {
+
+    return num_completed_;
+}
+
+
+float ResourceManager::GetLoadingProgress(void) const {
+
+    if (num_requested_ == 0){
+        return 1.0;
+    }
+    return (float) num_completed_ / (float) num_requested_;
+}
+
+
+void ResourceManager::LoaderLoop(void){
+
+    while (true){
+        // Wait for a request
+        PendingLoad *load;
+        {
+            std::unique_lock<std::mutex> lock(load_mutex_);
+            load_wake_.wait(lock, [this]{ return load_quit_ || !load_request_.empty(); });
+            if (load_quit_){
+                return;
+            }
+            load = load_request_.front();
+            load_request_.pop_front();
+        }
+
+        // Errors are reported on the main thread, when the resource would
+        // have been completed
+        try {
+            ReadResource(*load);
+        }
+        catch (std::exception &e){
+            load->error = e.what();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(load_mutex_);
+            load_done_.push_back(load);
+        }
+        load_done_wake_.notify_all();
+    }
+}
+
+
+void ResourceManager::ReadResource(PendingLoad &load){
 
     // Call appropriate method depending on type of resource
-    if (type == Material){
-        LoadMaterial(name, filename);
-    } else if (type == Texture){
-        LoadTexture(name, filename);
-    } else if (type == Mesh){
-        LoadMesh(name, filename);
+    if (load.type == Material){
+        ReadMaterial(load.filename.c_str(), load.source);
+    } else if (load.type == Texture){
+        ReadTexture(load);
+    } else if (load.type == Mesh){
+        ReadMesh(load);
     } else {
         throw(std::invalid_argument(std::string("Invalid type of resource")));
     }
 }
 
 
-Resource *ResourceManager::GetResource(const std::string name) const {
+void ResourceManager::CompleteResource(PendingLoad &load){
 
-    // Find resource with the specified name
-    for (int i = 0; i < resource_.size(); i++){
-        if (resource_[i]->GetName() == name){
-            return resource_[i];
+    if (load.type == Material){
+        // Loads completed right away have not been submitted yet
+        if (!load.program){
+            SubmitProgram(load);
+        }
+        GLuint program = FinishProgram(load);
+        Resource *res = load.resource;
+        if (res){
+            res->SetResource(program);
+        } else {
+            res = AddResource(Material, load.name, program, 0);
+        }
+        WatchMaterial(res, load.filename);
+    } else if (load.type == Texture){
+        GLuint texture = CreateTexture(load);
+        Resource *res = load.resource;
+        if (res){
+            res->SetResource(texture);
+        } else {
+            res = AddResource(Texture, load.name, texture, 0);
+        }
+        res->SetSampler(GetTextureSampler());
+    } else if (load.type == Mesh){
+        GLuint vbo, ebo;
+        UploadMesh(load.vertex_data, load.num_vertices, load.index_data, load.num_indices, load.vertex_format, vbo, ebo);
+        Resource *res = load.resource;
+        if (res){
+            res->SetGeometry(vbo, ebo, CreateVertexArray(vbo, ebo, load.vertex_format), load.num_indices);
+        } else {
+            res = AddResource(Mesh, load.name, vbo, ebo, load.num_indices, load.vertex_format);
         }
+        res->SetBounds(load.center, load.radius);
+        res->SetACMR(load.acmr_before, load.acmr_after);
     }
-    return NULL;
 }
 
 
-void ResourceManager::LoadMaterial(const std::string name, const char *prefix){
+void ResourceManager::WatchMaterial(Resource *res, const std::string &prefix){
 
-	// Load vertex program source code
-	std::string filename = std::string(prefix) + std::string(VERTEX_PROGRAM_EXTENSION);
-	std::string vp = LoadTextFile(filename.c_str());
+    const char *extension[3] = {VERTEX_PROGRAM_EXTENSION, FRAGMENT_PROGRAM_EXTENSION, GEOMETRY_PROGRAM_EXTENSION};
+    for (int i = 0; i < 3; i++){
+        std::string filename = prefix + std::string(extension[i]);
+        WatchedMaterial watched;
+        watched.resource = res;
+        watched.prefix = prefix;
+        watched_material_[filename] = watched;
+        // The geometry program is optional, and may be added later
+        material_watcher_.AddFile(filename);
+    }
+}
 
-	// Load fragment program source code
-	filename = std::string(prefix) + std::string(FRAGMENT_PROGRAM_EXTENSION);
-	std::string fp = LoadTextFile(filename.c_str());
 
-	// Create a shader from the vertex program source code
-	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-	const char *source_vp = vp.c_str();
-	glShaderSource(vs, 1, &source_vp, NULL);
-	glCompileShader(vs);
+int ResourceManager::ReloadModifiedMaterials(void){
 
-	// Check if shader compiled successfully
-	GLint status;
-	glGetShaderiv(vs, GL_COMPILE_STATUS, &status);
-	if (status != GL_TRUE) {
-		char buffer[512];
-		glGetShaderInfoLog(vs, 512, NULL, buffer);
-		throw(std::ios_base::failure(std::string("Error compiling vertex shader: ") + std::string(buffer)));
-	}
+    std::vector<std::string> modified;
+    material_watcher_.GetModifiedFiles(modified);
 
-	// Create a shader from the fragment program source code
-	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-	const char *source_fp = fp.c_str();
-	glShaderSource(fs, 1, &source_fp, NULL);
-	glCompileShader(fs);
+    // Editing several files of one material reloads it once
+    std::vector<Resource *> reloaded;
+    for (unsigned int i = 0; i < modified.size(); i++){
+        std::unordered_map<std::string, WatchedMaterial>::const_iterator it = watched_material_.find(modified[i]);
+        if (it == watched_material_.end()){
+            continue;
+        }
+        Resource *res = it->second.resource;
+        if (std::find(reloaded.begin(), reloaded.end(), res) != reloaded.end()){
+            continue;
+        }
 
-	// Check if shader compiled successfully
-	glGetShaderiv(fs, GL_COMPILE_STATUS, &status);
-	if (status != GL_TRUE) {
-		char buffer[512];
-		glGetShaderInfoLog(fs, 512, NULL, buffer);
-		throw(std::ios_base::failure(std::string("Error compiling fragment shader: ") + std::string(buffer)));
-	}
+        // Compile the new program and wait for it; the sources are small
+        // and only change while editing
+        PendingLoad load(Material, res->GetName(), it->second.prefix.c_str(), res->GetVertexFormat());
+        try {
+            ReadResource(load);
+            SubmitProgram(load);
+            GLuint program = FinishProgram(load);
+            GLuint old_program = res->GetResource();
+            res->SetResource(program);
+            glDeleteProgram(old_program);
+            reloaded.push_back(res);
+            std::cout << "Reloaded material " << res->GetName() << std::endl;
+        }
+        catch (std::exception &e){
+            // Keep drawing with the old program until the error is fixed
+            // (FinishProgram already freed the failed program)
+            std::cerr << "Could not reload material " << res->GetName() << ": " << e.what() << std::endl;
+        }
+    }
+
+    return (int) reloaded.size();
+}
+
+
+Resource *ResourceManager::GetResource(const std::string &name) const {
+
+    return GetResource(GetResourceHandle(name));
+}
+
+
+ResourceHandle ResourceManager::GetResourceHandle(const std::string &name) const {
+
+    // Find resource with the specified name
+    std::unordered_map<std::string, ResourceHandle>::const_iterator it = resource_index_.find(name);
+    if (it == resource_index_.end()){
+        return INVALID_RESOURCE_HANDLE;
+    }
+    return it->second;
+}
+
+
+Resource *ResourceManager::GetResource(ResourceHandle handle) const {
+
+    if (handle < 0 || handle >= (ResourceHandle) resource_.size()){
+        return NULL;
+    }
+    return resource_[handle];
+}
+
+
+void ResourceManager::ReadMaterial(const char *prefix, std::string source[3]){
+
+	// Load vertex program source code
+	std::string filename = std::string(prefix) + std::string(VERTEX_PROGRAM_EXTENSION);
+	source[0] = LoadTextFile(filename.c_str());
+
+	// Load fragment program source code
+	filename = std::string(prefix) + std::string(FRAGMENT_PROGRAM_EXTENSION);
+	source[1] = LoadTextFile(filename.c_str());
 
 	// Try to also load a geometry shader
 	filename = std::string(prefix) + std::string(GEOMETRY_PROGRAM_EXTENSION);
-	bool geometry_program = false;
-	std::string gp = "";
-	GLuint gs;
+	source[2] = "";
 	try {
-		gp = LoadTextFile(filename.c_str());
-		geometry_program = true;
+		source[2] = LoadTextFile(filename.c_str());
 	}
 	catch (std::exception &e) {
 	}
+}
 
-	if (geometry_program) {
-		// Create a shader from the geometry program source code
-		gs = glCreateShader(GL_GEOMETRY_SHADER);
-		const char *source_gp = gp.c_str();
-		glShaderSource(gs, 1, &source_gp, NULL);
-		glCompileShader(gs);
-
-		// Check if shader compiled successfully
-		GLint status;
-		glGetShaderiv(gs, GL_COMPILE_STATUS, &status);
-		if (status != GL_TRUE) {
-			char buffer[512];
-			glGetShaderInfoLog(gs, 512, NULL, buffer);
-			throw(std::ios_base::failure(std::string("Error compiling geometry shader: ") + std::string(buffer)));
-		}
+
+void ResourceManager::SubmitProgram(PendingLoad &load){
+
+	// Use the program binary saved by an earlier run, if it was built from
+	// the same sources by the same driver
+	load.program_key = GetProgramKey(load.source);
+	load.program = LoadProgramBinary(load.filename + std::string(PROGRAM_CACHE_EXTENSION), load.program_key);
+	if (load.program) {
+		return;
 	}
 
-	// Create a shader program linking both vertex and fragment shaders
-	// together
+	// Compile the vertex, fragment and (if there is one) geometry shaders,
+	// and link them, without waiting for the result; FinishProgram checks
+	// it
+	EnableParallelShaderCompile();
+	const GLenum stage[3] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER};
 	GLuint sp = glCreateProgram();
-	glAttachShader(sp, vs);
-	glAttachShader(sp, fs);
-	if (geometry_program) {
-		glAttachShader(sp, gs);
+	for (int i = 0; i < 3; i++) {
+		if (load.source[i].empty() && (i == 2)) {
+			continue;
+		}
+		load.shader[i] = glCreateShader(stage[i]);
+		const char *source = load.source[i].c_str();
+		glShaderSource(load.shader[i], 1, &source, NULL);
+		glCompileShader(load.shader[i]);
+		glAttachShader(sp, load.shader[i]);
 	}
+
+	// Use the same attribute locations in all programs, so that vertex
+	// arrays are independent of the material
+	glBindAttribLocation(sp, VERTEX_ATTRIBUTE_LOCATION, "vertex");
+	glBindAttribLocation(sp, VERTEX_ATTRIBUTE_LOCATION, "position");
+	glBindAttribLocation(sp, NORMAL_ATTRIBUTE_LOCATION, "normal");
+	glBindAttribLocation(sp, COLOR_ATTRIBUTE_LOCATION, "color");
+	glBindAttribLocation(sp, UV_ATTRIBUTE_LOCATION, "uv");
+	glBindAttribLocation(sp, INSTANCE_POSITION_ATTRIBUTE_LOCATION, "instance_position");
+	glBindAttribLocation(sp, INSTANCE_ORIENTATION_ATTRIBUTE_LOCATION, "instance_orientation");
+	glBindAttribLocation(sp, INSTANCE_SCALE_ATTRIBUTE_LOCATION, "instance_scale");
+	SetProgramBinaryRetrievable(sp);
 	glLinkProgram(sp);
 
-	// Check if shaders were linked successfully
-	glGetProgramiv(sp, GL_LINK_STATUS, &status);
+	load.program = sp;
+}
+
+
+GLuint ResourceManager::FinishProgram(PendingLoad &load){
+
+	// Linking fails if any shader did not compile; only then are the
+	// shaders checked, to report which one failed
+	GLint status;
+	glGetProgramiv(load.program, GL_LINK_STATUS, &status);
 	if (status != GL_TRUE) {
+		const char *stage_name[3] = {"vertex", "fragment", "geometry"};
 		char buffer[512];
-		glGetShaderInfoLog(sp, 512, NULL, buffer);
-		throw(std::ios_base::failure(std::string("Error linking shaders: ") + std::string(buffer)));
+		std::string error;
+		for (int i = 0; i < 3; i++) {
+			if (!load.shader[i]) {
+				continue;
+			}
+			glGetShaderiv(load.shader[i], GL_COMPILE_STATUS, &status);
+			if (status != GL_TRUE) {
+				glGetShaderInfoLog(load.shader[i], 512, NULL, buffer);
+				error = std::string("Error compiling ") + std::string(stage_name[i]) + std::string(" shader: ") + std::string(buffer);
+				break;
+			}
+		}
+		if (error.empty()) {
+			glGetProgramInfoLog(load.program, 512, NULL, buffer);
+			error = std::string("Error linking shaders: ") + std::string(buffer);
+		}
+
+		// Nothing refers to the program, so free it before reporting
+		// the error
+		for (int i = 0; i < 3; i++) {
+			if (load.shader[i]) {
+				glDeleteShader(load.shader[i]);
+				load.shader[i] = 0;
+			}
+		}
+		glDeleteProgram(load.program);
+		load.program = 0;
+		throw(std::ios_base::failure(error));
+	}
+
+	// Programs loaded from a binary have no shaders
+	if (!load.shader[0]) {
+		return load.program;
 	}
 
 	// Delete memory used by shaders, since they were already compiled
 	// and linked
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-	if (geometry_program) {
-		glDeleteShader(gs);
+	for (int i = 0; i < 3; i++) {
+		if (load.shader[i]) {
+			glDeleteShader(load.shader[i]);
+			load.shader[i] = 0;
+		}
 	}
 
-	// Add a resource for the shader program
-	AddResource(Material, name, sp, 0);
+	// Save the binary for the next runs; if it cannot be saved, the
+	// program is simply compiled again next time
+	SaveProgramBinary(load.filename + std::string(PROGRAM_CACHE_EXTENSION), load.program_key, load.program);
+
+	return load.program;
 }
 
 
@@ -188,393 +690,158 @@ std::string ResourceManager::LoadTextFile(const char *filename){
 }
 
 
-void ResourceManager::CreateTorus(std::string object_name, float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples){
-
-    // Create a torus
-    // The torus is built from a large loop with small circles around the loop
-
-    // Number of vertices and faces to be created
-    // Check the construction algorithm below to understand the numbers
-    // specified below
-    const GLuint vertex_num = num_loop_samples*num_circle_samples;
-    const GLuint face_num = num_loop_samples*num_circle_samples*2;
+void ResourceManager::CreateTorus(std::string object_name, float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples, VertexFormatType vertex_format, int num_levels){
 
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    // Data buffers for the torus
-    GLfloat *vertex = NULL;
-    GLuint *face = NULL;
-
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-        face = new GLuint[face_num * face_att]; // 3 indices per face
-    }
-    catch  (std::exception &e){
-        throw e;
-    }
+    // Generate the torus on the job system threads, then create OpenGL
+    // buffers and copy data
+    std::shared_ptr<const GeneratedGeometry> geometry = generator_.GenerateTorus(loop_radius, circle_radius, num_loop_samples, num_circle_samples);
+    Resource *res = CreateGeneratedResource(object_name, *geometry, vertex_format);
 
-    // Create vertices 
-    float theta, phi; // Angles for circles
-    glm::vec3 loop_center;
-    glm::vec3 vertex_position;
-    glm::vec3 vertex_normal;
-    glm::vec3 vertex_color;
-    glm::vec2 vertex_coord;
-
-    for (int i = 0; i < num_loop_samples; i++){ // large loop
-        
-        theta = 2.0*glm::pi<GLfloat>()*i/num_loop_samples; // loop sample (angle theta)
-        loop_center = glm::vec3(loop_radius*cos(theta), loop_radius*sin(theta), 0); // centre of a small circle
-
-        for (int j = 0; j < num_circle_samples; j++){ // small circle
-            
-            phi = 2.0*glm::pi<GLfloat>()*j/num_circle_samples; // circle sample (angle phi)
-            
-            // Define position, normal and color of vertex
-            vertex_normal = glm::vec3(cos(theta)*cos(phi), sin(theta)*cos(phi), sin(phi));
-            vertex_position = loop_center + vertex_normal*circle_radius;
-            vertex_color = glm::vec3(1.0 - ((float) i / (float) num_loop_samples), 
-                                            (float) i / (float) num_loop_samples, 
-                                            (float) j / (float) num_circle_samples);
-            vertex_coord = glm::vec2(theta / (2.0*glm::pi<GLfloat>()),
-                                     phi / (2.0*glm::pi<GLfloat>()));
-
-            // Add vectors to the data buffer
-            for (int k = 0; k < 3; k++){
-                vertex[(i*num_circle_samples+j)*vertex_att + k] = vertex_position[k];
-                vertex[(i*num_circle_samples+j)*vertex_att + k + 3] = vertex_normal[k];
-                vertex[(i*num_circle_samples+j)*vertex_att + k + 6] = vertex_color[k];
-            }
-            vertex[(i*num_circle_samples+j)*vertex_att + 9] = vertex_coord[0];
-            vertex[(i*num_circle_samples+j)*vertex_att + 10] = vertex_coord[1];
-        }
+    // Coarser levels of detail, halving the number of samples each time
+    for (int level = 1; level < num_levels; level++){
+        int loop_samples = std::max(num_loop_samples >> level, MIN_LOD_LOOP_SAMPLES);
+        int circle_samples = std::max(num_circle_samples >> level, MIN_LOD_CIRCLE_SAMPLES);
+        std::string level_name = object_name + std::string("_LOD") + num_to_str<int>(level);
+        CreateTorus(level_name, loop_radius, circle_radius, loop_samples, circle_samples, vertex_format, 1);
+        res->AddLevelOfDetail(GetResource(level_name));
     }
+}
 
-    // Create triangles
-    for (int i = 0; i < num_loop_samples; i++){
-        for (int j = 0; j < num_circle_samples; j++){
-            // Two triangles per quad
-            glm::vec3 t1(((i + 1) % num_loop_samples)*num_circle_samples + j, 
-                         i*num_circle_samples + ((j + 1) % num_circle_samples),
-                         i*num_circle_samples + j);    
-            glm::vec3 t2(((i + 1) % num_loop_samples)*num_circle_samples + j,
-                         ((i + 1) % num_loop_samples)*num_circle_samples + ((j + 1) % num_circle_samples),
-                         i*num_circle_samples + ((j + 1) % num_circle_samples));
-            // Add two triangles to the data buffer
-            for (int k = 0; k < 3; k++){
-                face[(i*num_circle_samples+j)*face_att*2 + k] = (GLuint) t1[k];
-                face[(i*num_circle_samples+j)*face_att*2 + k + face_att] = (GLuint) t2[k];
-            }
-        }
-    }
 
-    // Create OpenGL buffers and copy data
-    //GLuint vao;
-    //glGenVertexArrays(1, &vao);
-    //glBindVertexArray(vao);
+void ResourceManager::CreateSphere(std::string object_name, float radius, int num_samples_theta, int num_samples_phi, VertexFormatType vertex_format, int num_levels){
 
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
+    // Generate the sphere on the job system threads, then create OpenGL
+    // buffers and copy data
+    std::shared_ptr<const GeneratedGeometry> geometry = generator_.GenerateSphere(radius, num_samples_theta, num_samples_phi);
+    Resource *res = CreateGeneratedResource(object_name, *geometry, vertex_format);
 
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete [] vertex;
-    delete [] face;
-
-    // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    // Coarser levels of detail, halving the number of samples each time
+    for (int level = 1; level < num_levels; level++){
+        int samples_theta = std::max(num_samples_theta >> level, MIN_LOD_THETA_SAMPLES);
+        int samples_phi = std::max(num_samples_phi >> level, MIN_LOD_PHI_SAMPLES);
+        std::string level_name = object_name + std::string("_LOD") + num_to_str<int>(level);
+        CreateSphere(level_name, radius, samples_theta, samples_phi, vertex_format, 1);
+        res->AddLevelOfDetail(GetResource(level_name));
+    }
 }
 
 
-void ResourceManager::CreateSphere(std::string object_name, float radius, int num_samples_theta, int num_samples_phi){
-
-    // Create a sphere using a well-known parameterization
+void ResourceManager::ReadTexture(PendingLoad &load){
 
-    // Number of vertices and faces to be created
-    const GLuint vertex_num = num_samples_theta*num_samples_phi;
-    const GLuint face_num = num_samples_theta*(num_samples_phi-1)*2;
+    // Decode image file
+    load.image = SOIL_load_image(load.filename.c_str(), &load.width, &load.height, &load.channels, SOIL_LOAD_AUTO);
+    if (!load.image){
+        throw(std::ios_base::failure(std::string("Error loading texture ")+load.filename+std::string(": ")+std::string(SOIL_last_result())));
+    }
+}
 
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;
-    const int face_att = 3;
 
-    // Data buffers 
-    GLfloat *vertex = NULL;
-    GLuint *face = NULL;
+GLuint ResourceManager::CreateTexture(PendingLoad &load){
 
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-        face = new GLuint[face_num * face_att]; // 3 indices per face
-    }
-    catch  (std::exception &e){
-        throw e;
-    }
-
-    // Create vertices 
-    float theta, phi; // Angles for parametric equation
-    glm::vec3 vertex_position;
-    glm::vec3 vertex_normal;
-    glm::vec3 vertex_color;
-    glm::vec2 vertex_coord;
-   
-    for (int i = 0; i < num_samples_theta; i++){
-            
-        theta = 2.0*glm::pi<GLfloat>()*i/(num_samples_theta-1); // angle theta
-            
-        for (int j = 0; j < num_samples_phi; j++){
-                    
-            phi = glm::pi<GLfloat>()*j/(num_samples_phi-1); // angle phi
-
-            // Define position, normal and color of vertex
-            vertex_normal = glm::vec3(cos(theta)*sin(phi), sin(theta)*sin(phi), -cos(phi));
-            // We need z = -cos(phi) to make sure that the z coordinate runs from -1 to 1 as phi runs from 0 to pi
-            // Otherwise, the normal will be inverted
-            vertex_position = glm::vec3(vertex_normal.x*radius, 
-                                        vertex_normal.y*radius, 
-                                        vertex_normal.z*radius),
-            vertex_color = glm::vec3(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi), ((float)j)/((float)num_samples_phi));
-            vertex_coord = glm::vec2(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi));
-
-            // Add vectors to the data buffer
-            for (int k = 0; k < 3; k++){
-                vertex[(i*num_samples_phi+j)*vertex_att + k] = vertex_position[k];
-                vertex[(i*num_samples_phi+j)*vertex_att + k + 3] = vertex_normal[k];
-                vertex[(i*num_samples_phi+j)*vertex_att + k + 6] = vertex_color[k];
-            }
-            vertex[(i*num_samples_phi+j)*vertex_att + 9] = vertex_coord[0];
-            vertex[(i*num_samples_phi+j)*vertex_att + 10] = vertex_coord[1];
+    // Create texture from the decoded image: with immutable storage, the
+    // whole mipmap chain is allocated at once; images with other than three
+    // or four channels are left to SOIL
+    GLuint texture = 0;
+    if ((GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) && ((load.channels == 3) || (load.channels == 4))){
+        GLsizei num_levels = 1;
+        while (((load.width >> num_levels) > 0) || ((load.height >> num_levels) > 0)){
+            num_levels++;
         }
-    }
-
-    // Create faces
-    for (int i = 0; i < num_samples_theta; i++){
-        for (int j = 0; j < (num_samples_phi-1); j++){
-            // Two triangles per quad
-            glm::vec3 t1(((i + 1) % num_samples_theta)*num_samples_phi + j, 
-                         i*num_samples_phi + (j + 1),
-                         i*num_samples_phi + j);
-            glm::vec3 t2(((i + 1) % num_samples_theta)*num_samples_phi + j, 
-                         ((i + 1) % num_samples_theta)*num_samples_phi + (j + 1), 
-                         i*num_samples_phi + (j + 1));
-            // Add two triangles to the data buffer
-            for (int k = 0; k < 3; k++){
-                face[(i*(num_samples_phi-1)+j)*face_att*2 + k] = (GLuint) t1[k];
-                face[(i*(num_samples_phi-1)+j)*face_att*2 + k + face_att] = (GLuint) t2[k];
-            }
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, num_levels, (load.channels == 4) ? GL_RGBA8 : GL_RGB8, load.width, load.height);
+        // Rows of the decoded image are not padded
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, load.width, load.height, (load.channels == 4) ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, load.image);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    } else {
+        texture = SOIL_create_OGL_texture(load.image, load.width, load.height, load.channels, SOIL_CREATE_NEW_ID, 0);
+        if (!texture){
+            throw(std::ios_base::failure(std::string("Error loading texture ")+load.filename+std::string(": ")+std::string(SOIL_last_result())));
         }
+        glBindTexture(GL_TEXTURE_2D, texture);
     }
+    SOIL_free_image_data(load.image);
+    load.image = NULL;
 
-    // Create OpenGL buffers and copy data
-    //GLuint vao;
-    //glGenVertexArrays(1, &vao);
-    //glBindVertexArray(vao);
-
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete [] vertex;
-    delete [] face;
+    // Build the mipmaps once, rather than when drawing; the filtering is
+    // also set on the texture, for when sampler objects are not supported
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    return texture;
 }
 
 
-void ResourceManager::LoadTexture(const std::string name, const char *filename){
+GLuint ResourceManager::GetTextureSampler(void){
 
-    // Load texture from file
-    GLuint texture = SOIL_load_OGL_texture(filename, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID, 0);
-    if (!texture){
-        throw(std::ios_base::failure(std::string("Error loading texture ")+std::string(filename)+std::string(": ")+std::string(SOIL_last_result())));
+    if (!texture_sampler_ && (GLEW_VERSION_3_3 || GLEW_ARB_sampler_objects)){
+        glGenSamplers(1, &texture_sampler_);
+        glSamplerParameteri(texture_sampler_, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+        glSamplerParameteri(texture_sampler_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
-
-    // Create resource
-    AddResource(Texture, name, texture, 0);
+    return texture_sampler_;
 }
 
 
-void ResourceManager::LoadMesh(const std::string name, const char *filename){
+void ResourceManager::ReadMesh(PendingLoad &load){
+
+    // Number of attributes for vertices and faces
+    const int vertex_att = 11;
+    const int face_att = 3;
+
+    const char *filename = load.filename.c_str();
+
+    // Loaded models may be concave, so they are also ordered for overdraw
+    const bool optimize_overdraw = true;
+    uint64_t options = GetMeshOptions(load.angle_weighted_normals, optimize_overdraw);
+
+    // Use the binary cache of the mesh if it is up to date: the blocks are
+    // uploaded straight from the mapped file
+    load.cache.reset(new MeshCache(filename, vertex_att, options));
+    if (load.cache->IsValid()){
+        load.vertex_data = load.cache->GetVertices();
+        load.num_vertices = load.cache->GetNumVertices();
+        load.index_data = load.cache->GetIndices();
+        load.num_indices = load.cache->GetNumIndices();
+        load.center = load.cache->GetBoundingCenter();
+        load.radius = load.cache->GetBoundingRadius();
+        return;
+    }
+    load.cache.reset();
 
     // First load model into memory. If that goes well, we transfer the
     // mesh to an OpenGL buffer
     TriMesh mesh;
 
     // Parse file
-    // Open file
-    std::ifstream f;
-    f.open(filename);
-    if (f.fail()){
-        throw(std::ios_base::failure(std::string("Error opening file ")+std::string(filename)));
-    }
-
-    // Parse lines
-    std::string line;
-    std::string ignore(" \t\r\n");
-    std::string part_separator(" \t");
-    std::string face_separator("/");
-    bool added_normal = false;
-    while (std::getline(f, line)){
-        // Clean extremities of the string
-        string_trim(line, ignore);
-        // Ignore comments
-        if ((line.size() <= 0) ||
-            (line[0] == '#')){
-            continue;
-        }
-        // Parse string
-        std::vector<std::string> part = string_split(line, part_separator);
-        // Check commands
-        if (!part[0].compare(std::string("v"))){
-            if (part.size() >= 4){
-                glm::vec3 position(str_to_num<float>(part[1].c_str()), str_to_num<float>(part[2].c_str()), str_to_num<float>(part[3].c_str()));
-                mesh.position.push_back(position);
-            } else {
-                throw(std::ios_base::failure(std::string("Error: v command should have exactly 3 parameters")));
-            }
-        } else if (!part[0].compare(std::string("vn"))){
-            if (part.size() >= 4){
-                glm::vec3 normal(str_to_num<float>(part[1].c_str()), str_to_num<float>(part[2].c_str()), str_to_num<float>(part[3].c_str()));
-                mesh.normal.push_back(normal);
-                added_normal = true;
-            } else {
-                throw(std::ios_base::failure(std::string("Error: vn command should have exactly 3 parameters")));
-            }
-        } else if (!part[0].compare(std::string("vt"))){
-            if (part.size() >= 3){
-                glm::vec2 tex_coord(str_to_num<float>(part[1].c_str()), str_to_num<float>(part[2].c_str()));
-                mesh.tex_coord.push_back(tex_coord);
-            } else {
-                throw(std::ios_base::failure(std::string("Error: vt command should have exactly 2 parameters")));
-            }
-        } else if (!part[0].compare(std::string("f"))){
-            if (part.size() >= 4){
-                if (part.size() > 5){
-                    throw(std::ios_base::failure(std::string("Error: f commands with more than 4 vertices not supported")));
-                } else if (part.size() == 5){
-                    // Break a quad into two triangles
-                    Quad quad;
-                    for (int i = 0; i < 4; i++){
-                        std::vector<std::string> fd = string_split_once(part[i+1], face_separator);
-                        if (fd.size() == 1){
-                            quad.i[i] = str_to_num<float>(fd[0].c_str())-1;
-                            quad.t[i] = -1;
-                            quad.n[i] = -1;
-                        } else if (fd.size() == 2){
-                            quad.i[i] = str_to_num<float>(fd[0].c_str())-1;
-                            quad.t[i] = str_to_num<float>(fd[1].c_str())-1;
-                            quad.n[i] = -1;
-                        } else if (fd.size() == 3){
-                            quad.i[i] = str_to_num<float>(fd[0].c_str())-1;
-                            if (std::string("").compare(fd[1]) != 0){
-                                quad.t[i] = str_to_num<float>(fd[1].c_str())-1;
-                            } else {
-                                quad.t[i] = -1;
-                            }
-                            quad.n[i] = str_to_num<float>(fd[2].c_str())-1;
-                        } else {
-                            throw(std::ios_base::failure(std::string("Error: f parameter should have 1 or 3 parameters separated by '/'")));
-                        }
-                    }
-                    Face face1, face2;
-                    face1.i[0] = quad.i[0]; face1.i[1] = quad.i[1]; face1.i[2] = quad.i[2];
-                    face1.n[0] = quad.n[0]; face1.n[1] = quad.n[1]; face1.n[2] = quad.n[2];
-                    face1.t[0] = quad.t[0]; face1.t[1] = quad.t[1]; face1.t[2] = quad.t[2];
-                    face2.i[0] = quad.i[0]; face2.i[1] = quad.i[2]; face2.i[2] = quad.i[3];
-                    face2.n[0] = quad.n[0]; face2.n[1] = quad.n[2]; face2.n[2] = quad.n[3];
-                    face2.t[0] = quad.t[0]; face2.t[1] = quad.t[2]; face2.t[2] = quad.t[3];
-                    mesh.face.push_back(face1);
-                    mesh.face.push_back(face2);
-                } else if (part.size() == 4){
-                    Face face;
-                    for (int i = 0; i < 3; i++){
-                        std::vector<std::string> fd = string_split_once(part[i+1], face_separator);
-                        if (fd.size() == 1){
-                            face.i[i] = str_to_num<float>(fd[0].c_str())-1;
-                            face.t[i] = -1;
-                            face.n[i] = -1;
-                        } else if (fd.size() == 2){
-                            face.i[i] = str_to_num<float>(fd[0].c_str())-1;
-                            face.t[i] = str_to_num<float>(fd[1].c_str())-1;
-                            face.n[i] = -1;
-                        } else if (fd.size() == 3){
-                            face.i[i] = str_to_num<float>(fd[0].c_str())-1;
-                            if (std::string("").compare(fd[1]) != 0){
-                                face.t[i] = str_to_num<float>(fd[1].c_str())-1;
-                            } else {
-                                face.t[i] = -1;
-                            }
-                            face.n[i] = str_to_num<float>(fd[2].c_str())-1;
-                        } else {
-                            throw(std::ios_base::failure(std::string("Error: f parameter should have 1, 2, or 3 parameters separated by '/'")));
-                        }
-                    }
-                    mesh.face.push_back(face);
-                }
-            } else {
-                throw(std::ios_base::failure(std::string("Error: f command should have 3 or 4 parameters")));
-            }
-        }
-        // Ignore other commands
-    }
-
-    // Close file
-    f.close();
+    LoadObj(filename, mesh);
+    bool added_normal = !mesh.normal.empty();
 
     // Check if vertex references are correct
     for (unsigned int i = 0; i < mesh.face.size(); i++){
         for (int j = 0; j < 3; j++){
-            if (mesh.face[i].i[j] >= mesh.position.size()){
+            if ((mesh.face[i].i[j] < 0) || (mesh.face[i].i[j] >= (int) mesh.position.size())){
                 throw(std::ios_base::failure(std::string("Error: index for triangle ")+num_to_str<int>(mesh.face[i].i[j])+std::string(" is out of bounds")));
             }
-        }
-    }
-
-    // Compute degree of each vertex
-    std::vector<int> degree(mesh.position.size(), 0);
-    for (unsigned int i = 0; i < mesh.face.size(); i++){
-        for (int j = 0; j < 3; j++){
-            degree[mesh.face[i].i[j]]++;
+            if ((mesh.face[i].n[j] >= (int) mesh.normal.size()) || (mesh.face[i].t[j] >= (int) mesh.tex_coord.size())){
+                throw(std::ios_base::failure(std::string("Error: normal or texture coordinate index for triangle ")+num_to_str<int>(i)+std::string(" is out of bounds")));
+            }
         }
     }
 
     // Compute vertex normals if no normals were ever added
-    if (!added_normal){
-        mesh.normal = std::vector<glm::vec3>(mesh.position.size(), glm::vec3(0.0, 0.0, 0.0));
+    if (!added_normal && !mesh.face.empty()){
+        std::vector<GLuint> triangle(mesh.face.size() * 3);
         for (unsigned int i = 0; i < mesh.face.size(); i++){
-            // Compute face normal
-            glm::vec3 vec1, vec2;
-            vec1 = mesh.position[mesh.face[i].i[0]] -
-                        mesh.position[mesh.face[i].i[1]];
-            vec2 = mesh.position[mesh.face[i].i[0]] -
-                        mesh.position[mesh.face[i].i[2]];
-            glm::vec3 norm = glm::cross(vec1, vec2);
-            norm = glm::normalize(norm);
-            // Add face normal to vertices
-            mesh.normal[mesh.face[i].i[0]] += norm;
-            mesh.normal[mesh.face[i].i[1]] += norm;
-            mesh.normal[mesh.face[i].i[2]] += norm;
-        }
-        for (unsigned int i = 0; i < mesh.normal.size(); i++){
-            if (degree[i] > 0){
-                mesh.normal[i] /= degree[i];
+            for (int j = 0; j < 3; j++){
+                triangle[i*3 + j] = mesh.face[i].i[j];
             }
         }
+        mesh.normal = std::vector<glm::vec3>(mesh.position.size(), glm::vec3(0.0, 0.0, 0.0));
+        ComputeVertexNormals(&mesh.position[0][0], 3, &mesh.normal[0][0], 3, (int) mesh.position.size(), &triangle[0], (int) mesh.face.size(), load.angle_weighted_normals);
     }
 
     // Debug
@@ -582,143 +849,124 @@ void ResourceManager::LoadMesh(const std::string name, const char *filename){
 
     // If we got to this point, the file was parsed successfully and the
     // mesh is in memory
-    // Now, transfer the mesh to OpenGL buffers
-    // Create three new vertices for each face, in case vertex
-    // normals/texture coordinates are not consistent over the mesh
+    // Now, build the vertex and index arrays and transfer them to OpenGL
+    // buffers. Normals and texture coordinates may not be consistent over
+    // the mesh, so a vertex is a (position, normal, texture coordinate)
+    // triple; each distinct triple is emitted once and shared by all the
+    // faces that use it
+
+    std::vector<GLfloat> &vertex = load.vertex;
+    std::vector<GLuint> &index = load.index;
+    index.resize(mesh.face.size() * face_att);
+    std::unordered_map<MeshVertexKey, GLuint, MeshVertexKeyHash> vertex_index;
+    vertex_index.reserve(mesh.face.size() * face_att);
+    vertex.reserve(mesh.position.size() * vertex_att);
 
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    // Create OpenGL buffers and copy data
-    GLuint vbo, ebo;
-
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, mesh.face.size() * 3 * vertex_att * sizeof(GLuint), 0, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.face.size() * face_att * sizeof(GLuint), 0, GL_STATIC_DRAW);
-
-    unsigned int vertex_index = 0;
     for (unsigned int i = 0; i < mesh.face.size(); i++){
-        // Add three vertices and their attributes
-        GLfloat att[3 * vertex_att] = { 0 };
         for (int j = 0; j < 3; j++){
+            // Computed normals belong to the position
+            MeshVertexKey key;
+            key.position = mesh.face[i].i[j];
+            key.normal = added_normal ? mesh.face[i].n[j] : mesh.face[i].i[j];
+            key.tex_coord = mesh.face[i].t[j];
+
+            GLuint num_vertices = (GLuint) (vertex.size() / vertex_att);
+            std::pair<std::unordered_map<MeshVertexKey, GLuint, MeshVertexKeyHash>::iterator, bool> found = vertex_index.insert(std::make_pair(key, num_vertices));
+            index[i*face_att + j] = found.first->second;
+            if (!found.second){
+                continue;
+            }
+
+            // New vertex: add its attributes
+            GLfloat att[vertex_att] = { 0 };
             // Position
-            att[j*vertex_att + 0] = mesh.position[mesh.face[i].i[j]][0];
-            att[j*vertex_att + 1] = mesh.position[mesh.face[i].i[j]][1];
-            att[j*vertex_att + 2] = mesh.position[mesh.face[i].i[j]][2];
+            att[0] = mesh.position[key.position][0];
+            att[1] = mesh.position[key.position][1];
+            att[2] = mesh.position[key.position][2];
             // Normal
-            if (!added_normal){
-                att[j*vertex_att + 3] = mesh.normal[mesh.face[i].i[j]][0];
-                att[j*vertex_att + 4] = mesh.normal[mesh.face[i].i[j]][1];
-                att[j*vertex_att + 5] = mesh.normal[mesh.face[i].i[j]][2];
-            } else {
-                if (mesh.face[i].n[j] >= 0){
-                    att[j*vertex_att + 3] = mesh.normal[mesh.face[i].n[j]][0];
-                    att[j*vertex_att + 4] = mesh.normal[mesh.face[i].n[j]][1];
-                    att[j*vertex_att + 5] = mesh.normal[mesh.face[i].n[j]][2];
-                }
+            if (key.normal >= 0){
+                att[3] = mesh.normal[key.normal][0];
+                att[4] = mesh.normal[key.normal][1];
+                att[5] = mesh.normal[key.normal][2];
             }
             // No color in (6, 7, 8)
             // Texture coordinates
-            if (mesh.face[i].t[j] >= 0){
-                att[j*vertex_att + 9] = mesh.tex_coord[mesh.face[i].t[j]][0];
-                att[j*vertex_att + 10] = mesh.tex_coord[mesh.face[i].t[j]][1];
+            if (key.tex_coord >= 0){
+                att[9] = mesh.tex_coord[key.tex_coord][0];
+                att[10] = mesh.tex_coord[key.tex_coord][1];
             }
+            vertex.insert(vertex.end(), att, att + vertex_att);
         }
-
-        // Copy attributes to buffer
-        glBufferSubData(GL_ARRAY_BUFFER, i * 3 * vertex_att * sizeof(GLfloat), 3 * vertex_att * sizeof(GLfloat), att);
-
-        // Add triangle
-        GLuint findex[face_att] = { 0 };
-        findex[0] = vertex_index;
-        findex[1] = vertex_index + 1;
-        findex[2] = vertex_index + 2;
-        vertex_index += 3;
-
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, i * face_att * sizeof(GLuint), face_att * sizeof(GLuint), findex);
     }
 
-    // Create resource
-    AddResource(Mesh, name, vbo, ebo, mesh.face.size() * face_att);
-}
-
-
-void string_trim(std::string str, std::string to_trim){
-
-    // Trim any character in to_trim from the beginning of the string str
-    while ((str.size() > 0) && 
-           (to_trim.find(str[0]) != std::string::npos)){
-        str.erase(0);
+    // Bounding sphere: centered on the bounding box of the vertices
+    glm::vec3 center(0.0, 0.0, 0.0);
+    float radius = 0.0;
+    if (mesh.position.size() > 0){
+        glm::vec3 box_min = mesh.position[0];
+        glm::vec3 box_max = mesh.position[0];
+        for (unsigned int i = 1; i < mesh.position.size(); i++){
+            box_min = glm::min(box_min, mesh.position[i]);
+            box_max = glm::max(box_max, mesh.position[i]);
+        }
+        center = (box_min + box_max) * 0.5f;
+        for (unsigned int i = 0; i < mesh.position.size(); i++){
+            radius = glm::max(radius, glm::length(mesh.position[i] - center));
+        }
     }
 
-    // Trim any character in to_trim from the end of the string str
-    while ((str.size() > 0) && 
-           (to_trim.find(str[str.size()-1]) != std::string::npos)){
-        str.erase(str.size()-1);
+    // Reorder for the vertex cache and overdraw
+    GLsizei num_vertices = (GLsizei) (vertex.size() / vertex_att);
+    if (!index.empty()){
+        num_vertices = OptimizeMeshAndMeasure(&vertex[0], vertex_att, num_vertices, &index[0], (GLsizei) index.size(), optimize_overdraw, load.acmr_before, load.acmr_after);
     }
-}
 
+    // Keep the arrays for creating the resource
+    load.vertex_data = vertex.empty() ? 0 : &vertex[0];
+    load.num_vertices = num_vertices;
+    load.index_data = index.empty() ? 0 : &index[0];
+    load.num_indices = (GLsizei) index.size();
+    load.center = center;
+    load.radius = radius;
+
+    // Save the result for the next runs; if the cache cannot be written,
+    // the mesh is simply parsed again next time
+    MeshCache::Write(filename, vertex_att, options, load.vertex_data, num_vertices, load.index_data, load.num_indices, center, radius);
+}
 
-std::vector<std::string> string_split(std::string str, std::string separator){
 
-    // Initialize output
-    std::vector<std::string> output;
-    output.push_back(std::string(""));
-    int string_index = 0;
+Resource *ResourceManager::CreateMeshResource(const std::string name, const GLfloat *vertex, GLsizei num_vertices, const GLuint *index, GLsizei num_indices, glm::vec3 center, float radius, VertexFormatType vertex_format){
 
-    // Analyze string
-    unsigned int i = 0;
-    while (i < str.size()){
-        // Check if character i is a separator
-        if (separator.find(str[i]) != std::string::npos){
-            // Split string
-            string_index++;
-            output.push_back(std::string(""));
-            // Skip separators
-            while ((i < str.size()) && (separator.find(str[i]) != std::string::npos)){
-                i++;
-            }
-        } else {
-            // Otherwise, copy string
-            output[string_index] += str[i];
-            i++;
-        }
-    }
+    GLuint vbo, ebo;
+    UploadMesh(vertex, num_vertices, index, num_indices, vertex_format, vbo, ebo);
 
-    return output;
+    // Create resource
+    Resource *res = AddResource(Mesh, name, vbo, ebo, num_indices, vertex_format);
+    res->SetBounds(center, radius);
+    return res;
 }
 
 
-std::vector<std::string> string_split_once(std::string str, std::string separator){
+void ResourceManager::UploadMesh(const GLfloat *vertex, GLsizei num_vertices, const GLuint *index, GLsizei num_indices, VertexFormatType vertex_format, GLuint &array_buffer, GLuint &element_array_buffer){
 
-    // Initialize output
-    std::vector<std::string> output;
-    output.push_back(std::string(""));
-    int string_index = 0;
+    // Number of attributes for vertices
+    const int vertex_att = 11;
 
-    // Analyze string
-    unsigned int i = 0;
-    while (i < str.size()){
-        // Check if character i is a separator
-        if (separator.find(str[i]) != std::string::npos){
-            // Split string
-            string_index++;
-            output.push_back(std::string(""));
-            // Skip single separator
-            i++;
-        } else {
-            // Otherwise, copy string
-            output[string_index] += str[i];
-            i++;
-        }
+    // Create OpenGL buffers and copy data in one upload each
+    glGenBuffers(1, &array_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, array_buffer);
+    if (vertex_format == FullVertexFormat){
+        glBufferData(GL_ARRAY_BUFFER, (size_t) num_vertices * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
+    } else {
+        const VertexFormat &format = GetVertexFormat(vertex_format);
+        std::vector<unsigned char> encoded;
+        EncodeVertices(vertex, num_vertices, format, encoded);
+        glBufferData(GL_ARRAY_BUFFER, encoded.size(), encoded.empty() ? 0 : &encoded[0], GL_STATIC_DRAW);
     }
 
-    return output;
+    glGenBuffers(1, &element_array_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t) num_indices * sizeof(GLuint), index, GL_STATIC_DRAW);
 }
 
 
@@ -750,26 +998,6 @@ void print_mesh(TriMesh &mesh){
 }
 
 
-template <typename T> std::string num_to_str(T num){
-
-    std::ostringstream ss;
-    ss << num;
-    return ss.str();
-}
-
-
-template <typename T> T str_to_num(const std::string &str){
-
-    std::istringstream ss(str);
-    T result;
-    ss >> result;
-    if (ss.fail()){
-        throw(std::ios_base::failure(std::string("Invalid number: ")+str));
-    }
-    return result;
-}
-
-
 void ResourceManager::CreateWall(std::string object_name){
 
     // Definition of the wall
@@ -796,137 +1024,20 @@ void ResourceManager::CreateWall(std::string object_name){
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, 2 * 3 * sizeof(GLuint), face, GL_STATIC_DRAW);
 
     // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, 2 * 3);
+    Resource *res = AddResource(Mesh, object_name, vbo, ebo, 2 * 3);
+    res->SetBounds(glm::vec3(0.0, 0.0, 0.0), sqrt(2.0f));
 }
 
 void ResourceManager::CreateSphereParticles(std::string object_name, int num_particles) {
 
-	// Create a set of points which will be the particles
-	// This is similar to drawing a sphere: we will sample points on a sphere, but will allow them to also deviate a bit from the sphere along the normal (change of radius)
-
-	// Data buffer
-	GLfloat *particle = NULL;
-
-	// Number of attributes per particle: position (3), normal (3), and color (3), texture coordinates (2)
-	const int particle_att = 11;
-
-	// Allocate memory for buffer
-	try {
-		particle = new GLfloat[num_particles * particle_att];
-	}
-	catch (std::exception &e) {
-		throw e;
-	}
-
-	float trad = 0.0; // Defines the starting point of the particles along the normal
-	float maxspray = 0.5; // This is how much we allow the points to deviate from the sphere
-	float u, v, w, theta, phi, spray; // Work variables
-
-	for (int i = 0; i < num_particles; i++) {
-
-		// Get three random numbers
-		u = ((double)rand() / (RAND_MAX));
-		v = ((double)rand() / (RAND_MAX));
-		w = ((double)rand() / (RAND_MAX));
-
-		// Use u to define the angle theta along one direction of the sphere
-		theta = u * 2.0*glm::pi<float>();
-		// Use v to define the angle phi along the other direction of the sphere
-		phi = acos(2.0*v - 1.0);
-		// Use w to define how much we can deviate from the surface of the sphere (change of radius)
-		spray = maxspray * pow((float)w, (float)(1.0 / 3.0)); // Cubic root of w
-
-		// Define the normal and point based on theta, phi and the spray
-		glm::vec3 normal(spray*cos(theta)*sin(phi), spray*sin(theta)*sin(phi), spray*cos(phi));
-		glm::vec3 position(normal.x*trad, normal.y*trad, normal.z*trad);
-		glm::vec3 color(i / (float)num_particles, 0.0, 1.0 - (i / (float)num_particles));
-
-		// Add vectors to the data buffer
-		for (int k = 0; k < 3; k++) {
-			particle[i*particle_att + k] = position[k];
-			particle[i*particle_att + k + 3] = normal[k];
-			particle[i*particle_att + k + 6] = color[k];
-		}
-	}
-
-	// Create OpenGL buffer and copy data
-	GLuint vbo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, num_particles * particle_att * sizeof(GLfloat), particle, GL_STATIC_DRAW);
-
-	// Free data buffers
-	delete[] particle;
-
-	// Create resource
-	AddResource(PointSet, object_name, vbo, 0, num_particles);
+	// Points sampled on a sphere, deviating a bit from the sphere along the normal
+	CreateGeneratedResource(object_name, *generator_.GenerateSphereParticles(num_particles), FullVertexFormat);
 }
 
 
-
-
-
 void ResourceManager::CreateFireParticles(std::string object_name, int num_particles) {
 
-	// Create a set of points which will be the particles
-	// This is similar to drawing a sphere: we will sample points on a sphere, but will allow them to also deviate a bit from the sphere along the normal (change of radius)
-
-	// Data buffer
-	GLfloat *particle = NULL;
-
-	// Number of attributes per particle: position (3), normal (3), and color (3), texture coordinates (2)
-	const int particle_att = 11;
-
-	// Allocate memory for buffer
-	try {
-		particle = new GLfloat[num_particles * particle_att];
-	}
-	catch (std::exception &e) {
-		throw e;
-	}
-
-	float trad = 0.2; // Defines the starting point of the particles along the normal
-	float maxspray = 0.5; // This is how much we allow the points to deviate from the sphere
-	float spread = 1.0 / 32.0f;
-	float u, v, w, theta, phi, offset; // Work variables
-
-	for (int i = 0; i < num_particles; i++) {
-
-		// Get three random numbers
-		u = ((double)rand() / (RAND_MAX));
-		v = ((double)rand() / (RAND_MAX));
-		w = ((double)rand() / (RAND_MAX));
-		offset = 4.0 * ((double)rand() / (RAND_MAX));		//time offset vs other particles
-
-		// Use u to define the angle theta along one direction of the sphere
-		theta = u * 2.0*glm::pi<float>();
-		// Use v to define the angle phi along the other direction of the sphere
-		phi = acos(v * spread - 1.0);
-
-		// Define the normal and point based on theta, phi and the spray
-		glm::vec3 normal(maxspray*cos(theta)*sin(phi), maxspray*sin(theta)*sin(phi), maxspray*cos(phi));
-		glm::vec3 position(normal.x*trad, normal.y*trad, normal.z*trad);
-		glm::vec3 color(i / (float)num_particles, offset, 1.0 - (i / (float)num_particles)); // We can use the color for debug, if needed
-		//encode time offset in g value of color
-		// Add vectors to the data buffer
-		for (int k = 0; k < 3; k++) {
-			particle[i*particle_att + k] = position[k];
-			particle[i*particle_att + k + 3] = normal[k];
-			particle[i*particle_att + k + 6] = color[k];
-		}
-	}
-
-	// Create OpenGL buffer and copy data
-	GLuint vbo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, num_particles * particle_att * sizeof(GLfloat), particle, GL_STATIC_DRAW);
-
-	// Free data buffers
-	delete[] particle;
-
-	// Create resource
-	AddResource(PointSet, object_name, vbo, 0, num_particles);
+	CreateGeneratedResource(object_name, *generator_.GenerateFireParticles(num_particles), FullVertexFormat);
 }
 
 
@@ -934,99 +1045,28 @@ void ResourceManager::CreateFireParticles(std::string object_name, int num_parti
 //One is the ring, two is the Explosion.
 void ResourceManager::CreateRingParticles(std::string object_name, int num_particles) {
 
-	// Create a set of points which will be the particles
-	// This is similar to drawing a sphere: we will sample points on a sphere, but will allow them to also deviate a bit from the sphere along the normal (change of radius)
-
-	// Data buffer
-	GLfloat *particle = NULL;
-
-	// Number of attributes per particle: position (3), normal (3), and color (3), texture coordinates (2)
-	const int particle_att = 11;
-
-	// Allocate memory for buffer
-	try {
-		particle = new GLfloat[num_particles * particle_att];
-	}
-	catch (std::exception &e) {
-		throw e;
-	}
-
-	float trad = 0.05; // Defines the starting point of the particles along the normal
-	float maxspray = 0.5; // This is how much we allow the points to deviate from the sphere
-	float u, v, w, theta, phi, spray; // Work variables
-
-	int num_explosion_particles = num_particles / 100;
-	int num_ring_particles = num_particles - num_explosion_particles;
-
-	for (int i = 0; i < num_explosion_particles; i++) {
-
-		// Get three random numbers
-		u = ((double)rand() / (RAND_MAX));
-		v = ((double)rand() / (RAND_MAX));
-		w = ((double)rand() / (RAND_MAX));
-
-		// Use u to define the angle theta along one direction of the sphere
-		theta = u * 2.0*glm::pi<float>();
-		// Use v to define the angle phi along the other direction of the sphere
-		phi = acos(2.0*v - 1.0);
-		// Use w to define how much we can deviate from the surface of the sphere (change of radius)
-		spray = maxspray * pow((float)w, (float)(1.0 / 3.0)); // Cubic root of w
-
-		// Define the normal and point based on theta, phi and the spray
-		glm::vec3 normal(spray*cos(theta)*sin(phi), spray*sin(theta)*sin(phi), spray*cos(phi));
-		glm::vec3 position(normal.x*trad, normal.y*trad, normal.z*trad);
-		glm::vec3 color(i / (float)num_explosion_particles, spray / maxspray, 1.0 - (i / (float)num_explosion_particles)); // We can use the color for debug, if needed
-
-		// Add vectors to the data buffer
-		for (int k = 0; k < 3; k++) {
-			particle[i*particle_att + k] = position[k];
-			particle[i*particle_att + k + 3] = normal[k] * 1;
-			particle[i*particle_att + k + 6] = color[k];
-		}
-	}
+	CreateGeneratedResource(object_name, *generator_.GenerateRingParticles(num_particles), FullVertexFormat);
+}
 
 
-	for (int i = 0; i < num_ring_particles; i++) {
-
-		// Get three random numbers
-		u = ((double)rand() / (RAND_MAX));
-		v = ((double)rand() / (RAND_MAX));
-		w = ((double)rand() / (RAND_MAX));
-
-		// Use u to define the angle theta along one direction of the sphere
-		theta = u * 2.0*glm::pi<float>();
-		// Use v to define the angle phi along the other direction of the sphere
-		phi = acos(2.0*v - 1.0);
-		phi = glm::pi<float>() / 2.0;
-		// Use w to define how much we can deviate from the surface of the sphere (change of radius)
-		spray = maxspray * (0.9 + w * 0.5); // Cubic root of w
-
-		// Define the normal and point based on theta, phi and the spray
-		glm::vec3 normal(spray*cos(theta)*sin(phi), spray*sin(theta)*sin(phi), spray*cos(phi));
-		glm::vec3 position(normal.x*trad, normal.y*trad, normal.z*trad);
-		glm::vec3 color(i / (float)num_ring_particles, spray / maxspray, 1.0 - (i / (float)num_ring_particles)); // We can use the color for debug, if needed
-		//std::cout << 1.0 - spray / maxspray << " " << spray / maxspray << " " << spray << std::endl;
-		// Add vectors to the data buffer
-		for (int k = 0; k < 3; k++) {
-			particle[(i + num_explosion_particles)*particle_att + k] = position[k];
-			particle[(i + num_explosion_particles)*particle_att + k + 3] = normal[k] * 1.0;
-			particle[(i + num_explosion_particles)*particle_att + k + 6] = color[k];
-		}
-	}
+Resource *ResourceManager::CreateGeneratedResource(const std::string name, const GeneratedGeometry &geometry, VertexFormatType vertex_format){
 
-	// Create OpenGL buffer and copy data
-	GLuint vbo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, num_particles * particle_att * sizeof(GLfloat), particle, GL_STATIC_DRAW);
+    // Meshes are uploaded like loaded meshes
+    if (!geometry.index.empty()){
+        Resource *res = CreateMeshResource(name, &geometry.vertex[0], geometry.num_vertices, &geometry.index[0], (GLsizei) geometry.index.size(), geometry.center, geometry.radius, vertex_format);
+        res->SetACMR(geometry.acmr_before, geometry.acmr_after);
+        return res;
+    }
 
-	// Free data buffers
-	delete[] particle;
+    // Point sets: create OpenGL buffer and copy data
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, geometry.vertex.size() * sizeof(GLfloat), geometry.vertex.empty() ? 0 : &geometry.vertex[0], GL_STATIC_DRAW);
 
-	// Create resource
-	AddResource(PointSet, object_name, vbo, 0, num_particles);
+    // Create resource
+    return AddResource(PointSet, name, vbo, 0, geometry.num_vertices);
 }
 
 
-
 } // namespace game;
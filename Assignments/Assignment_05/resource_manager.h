@@ -3,11 +3,18 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
 #include "resource.h"
+#include "geometry_generator.h"
+#include "file_watcher.h"
 
 // Default extensions for different shader source files
 #define VERTEX_PROGRAM_EXTENSION "_vp.glsl"
@@ -16,6 +23,10 @@
 
 namespace game {
 
+    // Stable reference to a resource: index of the resource in the manager
+    typedef int ResourceHandle;
+    const ResourceHandle INVALID_RESOURCE_HANDLE = -1;
+
     // Class that manages all resources
     class ResourceManager {
 
@@ -24,18 +35,62 @@ namespace game {
             ResourceManager(void);
             ~ResourceManager();
             // Add a resource that was already loaded and allocated to memory
-            void AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size);
-            void AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
-            // Load a resource from a file, according to the specified type
-            void LoadResource(ResourceType type, const std::string name, const char *filename);
+            // Returns the new resource
+            Resource *AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size);
+            Resource *AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size, VertexFormatType vertex_format = FullVertexFormat);
+            // Load a resource from a file, according to the specified type;
+            // meshes are stored in the given vertex format. Meshes without
+            // normals get smooth normals, weighted by the angles of the
+            // faces at each vertex if angle_weighted_normals is set (see
+            // ComputeVertexNormals)
+            void LoadResource(ResourceType type, const std::string name, const char *filename, VertexFormatType vertex_format = FullVertexFormat, bool angle_weighted_normals = false);
+            // Start loading a resource from a file and return a placeholder
+            // for it right away. Files are read and decoded on a loader
+            // thread; the placeholder becomes ready once
+            // ProcessLoadedResources creates its OpenGL objects, and nodes
+            // using it are not drawn until then
+            Resource *LoadResourceAsync(ResourceType type, const std::string name, const char *filename, VertexFormatType vertex_format = FullVertexFormat, bool angle_weighted_normals = false);
+            // Create the OpenGL objects of the resources read since the last
+            // call; call from the thread that owns the OpenGL context, e.g.,
+            // once per frame. Returns the number of resources completed
+            // Materials are loaded in batches: the programs of all the
+            // materials read so far are submitted to the driver before any
+            // is checked, so that drivers that compile in the background
+            // (GL_KHR_parallel_shader_compile) work on them together, and
+            // programs still compiling are checked on a later call
+            int ProcessLoadedResources(void);
+            // Wait for all requested resources and complete them
+            void FinishLoading(void);
+            // Progress of asynchronous loading: number of resources
+            // requested, number completed, and the fraction completed (1 if
+            // nothing was requested)
+            int GetNumRequestedResources(void) const;
+            int GetNumCompletedResources(void) const;
+            float GetLoadingProgress(void) const;
+            // Recompile the materials whose source files were modified since
+            // the last call, e.g., once per frame. The new program replaces
+            // the old one in the same resource, so nodes using the material
+            // draw with it right away; if it does not compile, the error is
+            // printed and the old program is kept. Returns the number of
+            // materials reloaded
+            int ReloadModifiedMaterials(void);
             // Get the resource with the specified name
-            Resource *GetResource(const std::string name) const;
+            Resource *GetResource(const std::string &name) const;
+            // Get the handle of the resource with the specified name, or
+            // INVALID_RESOURCE_HANDLE if there is no such resource
+            ResourceHandle GetResourceHandle(const std::string &name) const;
+            // Get the resource referenced by a handle
+            Resource *GetResource(ResourceHandle handle) const;
 
             // Methods to create specific resources
             // Create the geometry for a torus and add it to the list of resources
-            void CreateTorus(std::string object_name, float loop_radius = 0.6, float circle_radius = 0.2, int num_loop_samples = 90, int num_circle_samples = 30);
-            // Create the geometry for a sphere
-            void CreateSphere(std::string object_name, float radius = 0.6, int num_samples_theta = 90, int num_samples_phi = 45);
+            // With num_levels > 1, coarser levels of detail are added as
+            // well, each with half the samples of the previous one, under
+            // the names object_name_LOD1, object_name_LOD2, ...
+            void CreateTorus(std::string object_name, float loop_radius = 0.6, float circle_radius = 0.2, int num_loop_samples = 90, int num_circle_samples = 30, VertexFormatType vertex_format = FullVertexFormat, int num_levels = 1);
+            // Create the geometry for a sphere, with levels of detail as for
+            // the torus
+            void CreateSphere(std::string object_name, float radius = 0.6, int num_samples_theta = 90, int num_samples_phi = 45, VertexFormatType vertex_format = FullVertexFormat, int num_levels = 1);
             void CreateWall(std::string object_name);
 
 			// Create particles distributed over a sphere
@@ -43,18 +98,85 @@ namespace game {
 			void CreateFireParticles(std::string object_name, int num_particles = 5000);
 			void CreateRingParticles(std::string object_name, int num_particles = 10000);
         private:
-            // List storing all resources
+            // List storing all resources, indexed by handle
             std::vector<Resource*> resource_; 
+            // Map from resource name to handle
+            std::unordered_map<std::string, ResourceHandle> resource_index_;
+            // Builds and remembers the procedural geometry
+            GeometryGenerator generator_;
+
+            // Asynchronous loading: requests go to the loader thread, which
+            // returns them once their files are read
+            struct PendingLoad;
+            std::thread loader_;
+            std::mutex load_mutex_;
+            std::condition_variable load_wake_; // New request or quit
+            std::condition_variable load_done_wake_; // Request read
+            std::deque<PendingLoad *> load_request_;
+            std::deque<PendingLoad *> load_done_;
+            // Materials whose programs were submitted to the driver but not
+            // checked yet
+            std::vector<PendingLoad *> load_compiling_;
+            bool load_quit_;
+            int num_requested_;
+            int num_completed_;
+            GLuint texture_sampler_;
+
+            // Source files of the loaded materials, watched for changes
+            struct WatchedMaterial {
+                Resource *resource;
+                std::string prefix; // Prefix of the shader files
+            };
+            FileWatcher material_watcher_;
+            std::unordered_map<std::string, WatchedMaterial> watched_material_; // By file name
+
+            // Add a resource to the list and the name index
+            void RegisterResource(Resource *res);
+            // Create a vertex array recording the vertex layout of a geometry
+            GLuint CreateVertexArray(GLuint array_buffer, GLuint element_array_buffer, VertexFormatType vertex_format);
+ 
+            // Main function of the loader thread
+            void LoaderLoop(void);
+            // Loading is split in two steps: reading and decoding the files
+            // of a resource, which touches no state of the manager and may
+            // run on the loader thread, and creating its OpenGL objects
+            static void ReadResource(PendingLoad &load);
+            void CompleteResource(PendingLoad &load);
+            // Complete the resources read by the loader thread; unless wait
+            // is set, programs the driver is still compiling are left for
+            // the next call
+            int CompleteLoads(bool wait);
+            // Watch the source files of a loaded material
+            void WatchMaterial(Resource *res, const std::string &prefix);
  
             // Methods to load specific types of resources
-            // Load shaders programs
-            void LoadMaterial(const std::string name, const char *prefix);
+            // Load the sources of shader programs; start compiling and
+            // linking them (or load the program binary cached under the
+            // same prefix), and check the result
+            static void ReadMaterial(const char *prefix, std::string source[3]);
+            void SubmitProgram(PendingLoad &load);
+            GLuint FinishProgram(PendingLoad &load);
             // Load a text file into memory (could be source code)
-            std::string LoadTextFile(const char *filename);
-            // Load a texture from an image file: png, jpg, etc.
-            void LoadTexture(const std::string name, const char *filename);
-            // Loads a mesh in obj format
-            void LoadMesh(const std::string name, const char *filename);
+            static std::string LoadTextFile(const char *filename);
+            // Decode an image file (png, jpg, etc.) and create a texture
+            // with all its mipmaps
+            static void ReadTexture(PendingLoad &load);
+            GLuint CreateTexture(PendingLoad &load);
+            // Sampler object shared by the loaded textures, created on first
+            // use; 0 if sampler objects are not supported
+            GLuint GetTextureSampler(void);
+            // Read a mesh in obj format, or its binary cache if it is up to
+            // date; the cache is written after parsing
+            static void ReadMesh(PendingLoad &load);
+            // Upload vertices (11 floats each) and triangle indices to new
+            // buffers, converting the vertices to the given format, and add
+            // them as a mesh resource
+            Resource *CreateMeshResource(const std::string name, const GLfloat *vertex, GLsizei num_vertices, const GLuint *index, GLsizei num_indices, glm::vec3 center, float radius, VertexFormatType vertex_format);
+            // Upload vertices and indices to new buffers
+            void UploadMesh(const GLfloat *vertex, GLsizei num_vertices, const GLuint *index, GLsizei num_indices, VertexFormatType vertex_format, GLuint &array_buffer, GLuint &element_array_buffer);
+            // Upload generated geometry: a mesh if it has indices, otherwise
+            // a point set
+            Resource *CreateGeneratedResource(const std::string name, const GeneratedGeometry &geometry, VertexFormatType vertex_format);
 
     }; // class ResourceManager
 
@@ -1,18 +1,33 @@
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "scene_graph.h"
+#include "job_system.h"
+
+// Number of nodes updated by one job
+#define UPDATE_CHUNK_SIZE 64
+// Number of transformations whose matrices are rebuilt by one job
+#define MATRIX_CHUNK_SIZE 1024
+
+// Use SSE for frustum culling when the compiler targets it
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CULL_WITH_SSE
+#endif
 
 namespace game {
 
 SceneGraph::SceneGraph(void){
 
     background_color_ = glm::vec3(0.0, 0.0, 0.0);
+    drawn_nodes_ = 0;
+    culled_nodes_ = 0;
 }
 
 
@@ -38,7 +53,7 @@ SceneNode *SceneGraph::CreateNode(std::string node_name, Resource *geometry, Res
     SceneNode *scn = new SceneNode(node_name, geometry, material, texture);
 
     // Add node to the scene
-    node_.push_back(scn);
+    AddNode(scn);
 
     return scn;
 }
@@ -46,20 +61,37 @@ SceneNode *SceneGraph::CreateNode(std::string node_name, Resource *geometry, Res
 
 void SceneGraph::AddNode(SceneNode *node){
 
+    // The first node added under a name keeps it, as with the original
+    // linear search
+    NodeHandle handle = (NodeHandle) node_.size();
     node_.push_back(node);
+    node_index_.emplace(node->GetName(), handle);
+}
+
+
+SceneNode *SceneGraph::GetNode(const std::string &node_name) const {
+
+    return GetNode(GetNodeHandle(node_name));
 }
 
 
-SceneNode *SceneGraph::GetNode(std::string node_name) const {
+NodeHandle SceneGraph::GetNodeHandle(const std::string &node_name) const {
 
     // Find node with the specified name
-    for (int i = 0; i < node_.size(); i++){
-        if (node_[i]->GetName() == node_name){
-            return node_[i];
-        }
+    std::unordered_map<std::string, NodeHandle>::const_iterator it = node_index_.find(node_name);
+    if (it == node_index_.end()){
+        return INVALID_NODE_HANDLE;
     }
-    return NULL;
+    return it->second;
+}
 
+
+SceneNode *SceneGraph::GetNode(NodeHandle handle) const {
+
+    if (handle < 0 || handle >= (NodeHandle) node_.size()){
+        return NULL;
+    }
+    return node_[handle];
 }
 
 
@@ -84,20 +116,182 @@ void SceneGraph::Draw(Camera *camera){
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Draw all scene nodes
-    for (int i = 0; i < node_.size(); i++){
-        node_[i]->Draw(camera, 1);
-    }
+    DrawNodes(camera, 1);
 }
 
 
 void SceneGraph::Update(void){
 
-    for (int i = 0; i < node_.size(); i++){
-        node_[i]->Update();
+    JobSystem &jobs = JobSystem::GetInstance();
+
+    // Update the nodes in chunks spread over the worker threads; node
+    // updates only modify their own node, so chunks are independent
+    jobs.ParallelFor((int) node_.size(), UPDATE_CHUNK_SIZE, [this](int begin, int end){
+        for (int i = begin; i < end; i++){
+            node_[i]->Update();
+        }
+    });
+
+    // Rebuild the matrices of the nodes that moved in one pass over the
+    // transform store
+    TransformStore &store = SceneNode::GetTransformStore();
+    jobs.ParallelFor(store.GetSize(), MATRIX_CHUNK_SIZE, [&store](int begin, int end){
+        store.UpdateMatrices(begin, end);
+    });
+}
+
+
+// Test spheres against the six frustum planes; the arrays are padded to a
+// multiple of four
+static void TestSpheres(const glm::vec4 planes[6], const float *x, const float *y, const float *z, const float *radius, int count, unsigned char *visible){
+
+#ifdef CULL_WITH_SSE
+    // Four spheres at a time: a sphere is visible if its center is no
+    // further than its radius behind every plane
+    __m128 plane[6][4];
+    for (int p = 0; p < 6; p++){
+        for (int k = 0; k < 4; k++){
+            plane[p][k] = _mm_set1_ps(planes[p][k]);
+        }
+    }
+    __m128 zero = _mm_setzero_ps();
+    for (int i = 0; i < count; i += 4){
+        __m128 sx = _mm_loadu_ps(x + i);
+        __m128 sy = _mm_loadu_ps(y + i);
+        __m128 sz = _mm_loadu_ps(z + i);
+        __m128 neg_radius = _mm_sub_ps(zero, _mm_loadu_ps(radius + i));
+        __m128 inside = _mm_cmpeq_ps(zero, zero); // All bits set
+        for (int p = 0; p < 6; p++){
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, plane[p][0]), _mm_mul_ps(sy, plane[p][1])),
+                                  _mm_add_ps(_mm_mul_ps(sz, plane[p][2]), plane[p][3]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_radius));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; k++){
+            visible[i + k] = (mask >> k) & 1;
+        }
+    }
+#else
+    for (int i = 0; i < count; i++){
+        visible[i] = 1;
+        for (int p = 0; p < 6; p++){
+            float d = planes[p].x*x[i] + planes[p].y*y[i] + planes[p].z*z[i] + planes[p].w;
+            if (d < -radius[i]){
+                visible[i] = 0;
+                break;
+            }
+        }
+    }
+#endif
+}
+
+
+void SceneGraph::CullNodes(Camera *camera){
+
+    // Nodes without bounds are always visible
+    node_visible_.assign(node_.size(), 1);
+
+    // Pack the bounding spheres
+    cull_x_.clear();
+    cull_y_.clear();
+    cull_z_.clear();
+    cull_radius_.clear();
+    cull_node_.clear();
+    for (unsigned int i = 0; i < node_.size(); i++){
+        glm::vec3 center;
+        float radius;
+        if (node_[i]->GetWorldBounds(center, radius)){
+            cull_x_.push_back(center.x);
+            cull_y_.push_back(center.y);
+            cull_z_.push_back(center.z);
+            cull_radius_.push_back(radius);
+            cull_node_.push_back(i);
+        }
+    }
+    int count = (int) cull_node_.size();
+    int padded_count = (count + 3) & ~3;
+    cull_x_.resize(padded_count, 0.0f);
+    cull_y_.resize(padded_count, 0.0f);
+    cull_z_.resize(padded_count, 0.0f);
+    cull_radius_.resize(padded_count, 0.0f);
+    cull_visible_.resize(padded_count);
+
+    // Test them against the view frustum
+    glm::vec4 planes[6];
+    camera->GetFrustumPlanes(planes);
+    if (count > 0){
+        TestSpheres(planes, &cull_x_[0], &cull_y_[0], &cull_z_[0], &cull_radius_[0], padded_count, &cull_visible_[0]);
+    }
+
+    culled_nodes_ = 0;
+    for (int i = 0; i < count; i++){
+        if (!cull_visible_[i]){
+            node_visible_[cull_node_[i]] = 0;
+            culled_nodes_++;
+        }
+    }
+    drawn_nodes_ = (int) node_.size() - culled_nodes_;
+}
+
+
+void SceneGraph::DrawNodes(Camera *camera, int effect_num){
+
+    // Skip nodes outside the view
+    CullNodes(camera);
+
+    // Build the render queue
+    // Opaque nodes come first, grouped by program, then texture, then
+    // geometry (16 bits of each handle). Blended nodes come last and keep
+    // the order in which they were added, since blending depends on it
+    render_queue_.clear();
+    for (unsigned int i = 0; i < node_.size(); i++){
+        SceneNode *node = node_[i];
+        if (!node_visible_[i] || !node->IsReady()){
+            continue;
+        }
+        // The level of detail decides the vertex array, so select it first
+        node->SelectLevelOfDetail(camera);
+        std::uint64_t key;
+        if (node->GetBlending()){
+            key = (((std::uint64_t) 1) << 63) | i;
+        } else {
+            key = (((std::uint64_t) (node->GetMaterial() & 0xFFFF)) << 32) |
+                  (((std::uint64_t) (node->GetTexture() & 0xFFFF)) << 16) |
+                  ((std::uint64_t) (node->GetVertexArray() & 0xFFFF));
+        }
+        RenderItem item;
+        item.key = key;
+        item.node = node;
+        render_queue_.push_back(item);
+    }
+    std::stable_sort(render_queue_.begin(), render_queue_.end());
+
+    // Draw the queue, skipping redundant state changes
+    render_state_.Reset(effect_num);
+    for (unsigned int i = 0; i < render_queue_.size(); i++){
+        render_queue_[i].node->Draw(camera, &render_state_);
     }
 }
 
 
+int SceneGraph::GetStateChanges(void) const {
+
+    return render_state_.GetStateChanges();
+}
+
+
+int SceneGraph::GetDrawnNodes(void) const {
+
+    return drawn_nodes_;
+}
+
+
+int SceneGraph::GetCulledNodes(void) const {
+
+    return culled_nodes_;
+}
+
+
 void SceneGraph::SetupDrawToTexture(void){
 
     // Set up frame buffer
@@ -146,6 +340,16 @@ void SceneGraph::SetupDrawToTexture(void){
     glGenBuffers(1, &quad_array_buffer_);
     glBindBuffer(GL_ARRAY_BUFFER, quad_array_buffer_);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertex_data), quad_vertex_data, GL_STATIC_DRAW);
+
+    // Set up attributes of the screen-space shader, using the locations
+    // bound in every material
+    glGenVertexArrays(1, &quad_vertex_array_);
+    glBindVertexArray(quad_vertex_array_);
+    glEnableVertexAttribArray(VERTEX_ATTRIBUTE_LOCATION);
+    glVertexAttribPointer(VERTEX_ATTRIBUTE_LOCATION, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
+    glEnableVertexAttribArray(UV_ATTRIBUTE_LOCATION);
+    glVertexAttribPointer(UV_ATTRIBUTE_LOCATION, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void *) (3*sizeof(GLfloat)));
+    glBindVertexArray(0);
 }
 
 
@@ -166,9 +370,7 @@ void SceneGraph::DrawToTexture(Camera *camera, int effect_num){
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Draw all scene nodes
-    for (int i = 0; i < node_.size(); i++){
-        node_[i]->Draw(camera, effect_num);
-    }
+    DrawNodes(camera, effect_num);
 
     // Reset frame buffer
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -178,46 +380,47 @@ void SceneGraph::DrawToTexture(Camera *camera, int effect_num){
 }
 
 
-void SceneGraph::DisplayTexture(GLuint program, int effect_num){
+void SceneGraph::DisplayTexture(const Resource *material, int effect_num){
+
+    // Nothing to display with until the material is loaded
+    if (!material->IsReady()){
+        return;
+    }
 
     // Configure output to the screen
     //glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glDisable(GL_DEPTH_TEST);
 	
     // Set up quad geometry
-    glBindBuffer(GL_ARRAY_BUFFER, quad_array_buffer_);
+    glBindVertexArray(quad_vertex_array_);
 
     // Select proper material (shader program)
-    glUseProgram(program);
-
-    // Setup attributes of screen-space shader
-    GLint pos_att = glGetAttribLocation(program, "position");
-    glEnableVertexAttribArray(pos_att);
-    glVertexAttribPointer(pos_att, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
-
-    GLint tex_att = glGetAttribLocation(program, "uv");
-    glEnableVertexAttribArray(tex_att);
-    glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void *) (3*sizeof(GLfloat)));
+    glUseProgram(material->GetResource());
+    const MaterialLocations &locations = material->GetLocations();
 
 	// Timer
-	GLint timer_var = glGetUniformLocation(program, "timer");
 	float current_time = glfwGetTime();
-	glUniform1f(timer_var, current_time);
+	glUniform1f(locations.timer, current_time);
 
 	// Timer
-	GLint effect_var = glGetUniformLocation(program, "effect_num");
-	glUniform1i(effect_var, effect_num);
+	glUniform1i(locations.effect_num, effect_num);
 
 	
 	
-    // Bind texture
+    // Bind texture; the sampler of the scene textures would override its
+    // filtering, and it has no mipmaps
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture_);
+    if (GLEW_VERSION_3_3 || GLEW_ARB_sampler_objects){
+        glBindSampler(0, 0);
+    }
 
     // Draw geometry
     glDrawArrays(GL_TRIANGLES, 0, 6); // Quad: 6 coordinates
 
-    // Reset current geometry
+    // Reset current geometry, so that buffers created before the next
+    // frame do not modify the bindings of a vertex array
+    glBindVertexArray(0);
     glEnable(GL_DEPTH_TEST);
 }
 
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <cstdint>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -10,6 +12,7 @@
 #include "scene_node.h"
 #include "resource.h"
 #include "camera.h"
+#include "render_state.h"
 
 // Size of the texture that we will draw
 #define FRAME_BUFFER_WIDTH 1024
@@ -17,6 +20,10 @@
 
 namespace game {
 
+    // Stable reference to a scene node: index of the node in the scene
+    typedef int NodeHandle;
+    const NodeHandle INVALID_NODE_HANDLE = -1;
+
     // Class that manages all the objects in a scene
     class SceneGraph {
 
@@ -26,11 +33,39 @@ namespace game {
 
             // Scene nodes to render
             std::vector<SceneNode *> node_;
+            // Map from node name to handle
+            std::unordered_map<std::string, NodeHandle> node_index_;
+
+            // Render queue: nodes with a key encoding the state they need,
+            // sorted so that nodes sharing state are drawn together
+            struct RenderItem {
+                std::uint64_t key;
+                SceneNode *node;
+                bool operator<(const RenderItem &other) const { return key < other.key; }
+            };
+            std::vector<RenderItem> render_queue_;
+            // State tracked while drawing the queue
+            RenderState render_state_;
+
+            // Bounding spheres of the bounded nodes in world coordinates,
+            // packed into arrays for culling, and the node of each sphere
+            std::vector<float> cull_x_;
+            std::vector<float> cull_y_;
+            std::vector<float> cull_z_;
+            std::vector<float> cull_radius_;
+            std::vector<int> cull_node_;
+            std::vector<unsigned char> cull_visible_;
+            // Whether each node is in the view frustum
+            std::vector<unsigned char> node_visible_;
+            // Culling statistics of the last frame
+            int drawn_nodes_;
+            int culled_nodes_;
 
             // Frame buffer for drawing to texture
             GLuint frame_buffer_;
             // Quad vertex array for drawing from texture
             GLuint quad_array_buffer_;
+            GLuint quad_vertex_array_;
             // Render targets
             GLuint texture_;
             GLuint depth_buffer_;
@@ -49,7 +84,14 @@ namespace game {
             // Add an already-created node
             void AddNode(SceneNode *node);
             // Find a scene node with a specific name
-            SceneNode *GetNode(std::string node_name) const;
+            SceneNode *GetNode(const std::string &node_name) const;
+            // Get the handle of the node with a specific name, or
+            // INVALID_NODE_HANDLE if there is no such node
+            // Handles stay valid for the lifetime of the scene, so they
+            // can be looked up once and cached by per-frame code
+            NodeHandle GetNodeHandle(const std::string &node_name) const;
+            // Get the node referenced by a handle
+            SceneNode *GetNode(NodeHandle handle) const;
             // Get node const iterator
             std::vector<SceneNode *>::const_iterator begin() const;
             std::vector<SceneNode *>::const_iterator end() const;
@@ -57,19 +99,32 @@ namespace game {
             // Draw the entire scene
             void Draw(Camera *camera);
 
-            // Update entire scene
+            // Update entire scene; the nodes are updated in parallel on the
+            // threads of the job system
             void Update(void);
 
+            // Number of OpenGL state changes issued to draw the last frame
+            int GetStateChanges(void) const;
+            // Number of nodes drawn and culled in the last frame
+            int GetDrawnNodes(void) const;
+            int GetCulledNodes(void) const;
+
             // Drawing from/to a texture
             // Setup the texture
             void SetupDrawToTexture(void);
             // Draw the scene into a texture
             void DrawToTexture(Camera *camera, int effect_num);
             // Process and draw the texture on the screen
-            void DisplayTexture(GLuint program, int effect_num);
+            void DisplayTexture(const Resource *material, int effect_num);
             // Save texture to a file in ppm format
             void SaveTexture(char *filename);
 
+        private:
+            // Mark the nodes outside the view frustum of the camera
+            void CullNodes(Camera *camera);
+            // Sort the visible nodes into the render queue and draw them
+            void DrawNodes(Camera *camera, int effect_num);
+
     }; // class SceneGraph
 
 } // namespace game
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <stdexcept>
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/type_ptr.hpp>
@@ -23,31 +24,29 @@ SceneNode::SceneNode(const std::string name, const Resource *geometry, const Res
         throw(std::invalid_argument(std::string("Invalid type of geometry")));
     }
 
-    array_buffer_ = geometry->GetArrayBuffer();
-    element_array_buffer_ = geometry->GetElementArrayBuffer();
-    size_ = geometry->GetSize();
+    geometry_ = geometry;
+    lod_level_ = 0;
 
     // Set material (shader program)
     if (material->GetType() != Material){
         throw(std::invalid_argument(std::string("Invalid type of material")));
     }
 
-    material_ = material->GetResource();
+    material_ = material;
 
-    // Set texture
-    if (texture){
-        texture_ = texture->GetResource();
-    } else {
-        texture_ = 0;
-    }
+    // Set texture; the handle is read when drawing, since the texture
+    // may still be loading
+    texture_ = texture;
 
     // Other attributes
-    scale_ = glm::vec3(1.0, 1.0, 1.0);
+    transform_ = GetTransformStore().Allocate();
     blending_ = false;
 }
 
 
 SceneNode::~SceneNode(){
+
+    GetTransformStore().Release(transform_);
 }
 
 
@@ -59,19 +58,19 @@ const std::string SceneNode::GetName(void) const {
 
 glm::vec3 SceneNode::GetPosition(void) const {
 
-    return position_;
+    return GetTransformStore().GetPosition(transform_);
 }
 
 
 glm::quat SceneNode::GetOrientation(void) const {
 
-    return orientation_;
+    return GetTransformStore().GetOrientation(transform_);
 }
 
 
 glm::vec3 SceneNode::GetScale(void) const {
 
-    return scale_;
+    return GetTransformStore().GetScale(transform_);
 }
 
 
@@ -81,40 +80,73 @@ bool SceneNode::GetBlending(void) const {
 }
 
 
+bool SceneNode::GetWorldBounds(glm::vec3 &center, float &radius) const {
+
+    if (!geometry_->HasBounds()){
+        return false;
+    }
+
+    // Transform the sphere by the world matrix. A non-uniform scale is
+    // bounded by its largest factor
+    center = glm::vec3(GetWorldMatrix() * glm::vec4(geometry_->GetBoundingCenter(), 1.0));
+    glm::vec3 abs_scale = glm::abs(GetScale());
+    radius = geometry_->GetBoundingRadius() * glm::max(abs_scale.x, glm::max(abs_scale.y, abs_scale.z));
+    return true;
+}
+
+
 void SceneNode::SetPosition(glm::vec3 position){
 
-    position_ = position;
+    GetTransformStore().SetPosition(transform_, position);
 }
 
 
 void SceneNode::SetOrientation(glm::quat orientation){
 
-    orientation_ = orientation;
+    GetTransformStore().SetOrientation(transform_, orientation);
 }
 
 
 void SceneNode::SetScale(glm::vec3 scale){
 
-    scale_ = scale;
+    GetTransformStore().SetScale(transform_, scale);
 }
 
 
 void SceneNode::Translate(glm::vec3 trans){
 
-    position_ += trans;
+    GetTransformStore().Translate(transform_, trans);
 }
 
 
 void SceneNode::Rotate(glm::quat rot){
 
-    orientation_ *= rot;
-    orientation_ = glm::normalize(orientation_);
+    GetTransformStore().Rotate(transform_, rot);
 }
 
 
 void SceneNode::Scale(glm::vec3 scale){
 
-    scale_ *= scale;
+    GetTransformStore().Scale(transform_, scale);
+}
+
+
+const glm::mat4 &SceneNode::GetWorldMatrix(void) const {
+
+    return GetTransformStore().GetWorldMatrix(transform_);
+}
+
+
+const glm::mat4 &SceneNode::GetNormalMatrix(void) const {
+
+    return GetTransformStore().GetNormalMatrix(transform_);
+}
+
+
+TransformStore &SceneNode::GetTransformStore(void){
+
+    static TransformStore store;
+    return store;
 }
 
 
@@ -149,141 +181,147 @@ GLenum SceneNode::GetMode(void) const {
 
 GLuint SceneNode::GetArrayBuffer(void) const {
 
-    return array_buffer_;
+    return geometry_->GetLevelOfDetail(lod_level_)->GetArrayBuffer();
 }
 
 
 GLuint SceneNode::GetElementArrayBuffer(void) const {
 
-    return element_array_buffer_;
+    return geometry_->GetLevelOfDetail(lod_level_)->GetElementArrayBuffer();
+}
+
+
+GLuint SceneNode::GetVertexArray(void) const {
+
+    return geometry_->GetLevelOfDetail(lod_level_)->GetVertexArray();
 }
 
 
 GLsizei SceneNode::GetSize(void) const {
 
-    return size_;
+    return geometry_->GetLevelOfDetail(lod_level_)->GetSize();
 }
 
 
 GLuint SceneNode::GetMaterial(void) const {
 
-    return material_;
+    return material_->GetResource();
 }
 
 
-void SceneNode::Draw(Camera *camera, int effect_num){
+GLuint SceneNode::GetTexture(void) const {
 
-    // Select blending or not
-	if (blending_) {
-		// Disable z-buffer
-		glDisable(GL_DEPTH_TEST);
-		// Enable blending
-		glEnable(GL_BLEND);
-
-		if (effect_num == 3)
-		{
-		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // Simpler form
-		} 
-		else 
-		{
-        glBlendFuncSeparate(GL_SRC_ALPHA, GL_DST_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		}
-
-        glBlendEquationSeparate(GL_FUNC_ADD, GL_MIN);
-    } else {
-        // Enable z-buffer
-		glDisable(GL_BLEND);
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LESS);
-    }
+    return texture_ ? texture_->GetResource() : 0;
+}
 
-    // Select proper material (shader program)
-    glUseProgram(material_);
 
-    // Set geometry to draw
-    glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
+bool SceneNode::IsReady(void) const {
+
+    return geometry_->IsReady() && material_->IsReady() && (!texture_ || texture_->IsReady());
+}
+
+
+void SceneNode::Draw(Camera *camera, RenderState *state){
+
+    // Select blending or not
+    state->SetBlending(blending_);
 
-    // Set globals for camera
-    camera->SetupShader(material_);
+    // Select proper material (shader program)
+    const MaterialLocations &locations = material_->GetLocations();
+    if (state->UseProgram(material_->GetResource())){
+        // Set globals for camera, once per program
+        camera->SetupShader(locations);
+    }
 
     // Set world matrix and other shader input variables
-    SetupShader(material_);
+    SetupShader(locations, state);
 
     // Draw geometry
+    DrawGeometry(state);
+}
+
+
+void SceneNode::DrawGeometry(RenderState *state){
+
+    // Set geometry to draw: the vertex array holds the buffers and the
+    // attribute layout
+    const Resource *geometry = geometry_->GetLevelOfDetail(lod_level_);
+    state->BindVertexArray(geometry->GetVertexArray());
+
     if (mode_ == GL_POINTS){
-        glDrawArrays(mode_, 0, size_);
+        glDrawArrays(mode_, 0, geometry->GetSize());
     } else {
-        glDrawElements(mode_, size_, GL_UNSIGNED_INT, 0);
+        glDrawElements(mode_, geometry->GetSize(), GL_UNSIGNED_INT, 0);
     }
 }
 
 
-void SceneNode::Update(void){
+void SceneNode::SelectLevelOfDetail(const Camera *camera){
 
-    // Do nothing for this generic type of scene node
+    int num_levels = geometry_->GetNumLevelsOfDetail();
+    glm::vec3 center;
+    float radius;
+    if ((num_levels == 1) || !GetWorldBounds(center, radius)){
+        return;
+    }
+
+    lod_level_ = ChooseLevelOfDetail(camera->GetProjectedRadius(center, radius), lod_level_, num_levels);
 }
 
 
-void SceneNode::SetupShader(GLuint program){
+int SceneNode::ChooseLevelOfDetail(float projected_radius, int current_level, int num_levels){
+
+    // Level l is used between the switch radii LOD_DETAIL_RADIUS / 2^l
+    // (towards level l + 1) and LOD_DETAIL_RADIUS / 2^(l - 1) (towards
+    // level l - 1). Switching requires crossing a radius by the hysteresis
+    // margin
+    int level = current_level;
+    if (level >= num_levels){
+        level = num_levels - 1;
+    }
+    while ((level + 1 < num_levels) &&
+           (projected_radius < ldexpf(LOD_DETAIL_RADIUS, -level) * (1.0f - LOD_HYSTERESIS))){
+        level++;
+    }
+    while ((level > 0) &&
+           (projected_radius > ldexpf(LOD_DETAIL_RADIUS, 1 - level) * (1.0f + LOD_HYSTERESIS))){
+        level--;
+    }
+    return level;
+}
+
 
-    // Set attributes for shaders
-    GLint vertex_att = glGetAttribLocation(program, "vertex");
-    glVertexAttribPointer(vertex_att, 3, GL_FLOAT, GL_FALSE, 11*sizeof(GLfloat), 0);
-    glEnableVertexAttribArray(vertex_att);
+void SceneNode::Update(void){
 
-    GLint normal_att = glGetAttribLocation(program, "normal");
-    glVertexAttribPointer(normal_att, 3, GL_FLOAT, GL_FALSE, 11*sizeof(GLfloat), (void *) (3*sizeof(GLfloat)));
-    glEnableVertexAttribArray(normal_att);
+    // Do nothing for this generic type of scene node
+}
 
-    GLint color_att = glGetAttribLocation(program, "color");
-    glVertexAttribPointer(color_att, 3, GL_FLOAT, GL_FALSE, 11*sizeof(GLfloat), (void *) (6*sizeof(GLfloat)));
-    glEnableVertexAttribArray(color_att);
 
-    GLint tex_att = glGetAttribLocation(program, "uv");
-    glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 11*sizeof(GLfloat), (void *) (9*sizeof(GLfloat)));
-    glEnableVertexAttribArray(tex_att);
+void SceneNode::SetupShader(const MaterialLocations &locations, RenderState *state){
 
     // World transformation
-    glm::mat4 scaling = glm::scale(glm::mat4(1.0), scale_);
-    glm::mat4 rotation = glm::mat4_cast(orientation_);
-    glm::mat4 translation = glm::translate(glm::mat4(1.0), position_);
-    glm::mat4 transf = translation * rotation * scaling;
-
-    GLint world_mat = glGetUniformLocation(program, "world_mat");
-    glUniformMatrix4fv(world_mat, 1, GL_FALSE, glm::value_ptr(transf));
+    glUniformMatrix4fv(locations.world_mat, 1, GL_FALSE, glm::value_ptr(GetWorldMatrix()));
 
     // Normal matrix
-    glm::mat4 normal_matrix = glm::transpose(glm::inverse(transf));
-    GLint normal_mat = glGetUniformLocation(program, "normal_mat");
-    glUniformMatrix4fv(normal_mat, 1, GL_FALSE, glm::value_ptr(normal_matrix));
+    glUniformMatrix4fv(locations.normal_mat, 1, GL_FALSE, glm::value_ptr(GetNormalMatrix()));
 
     // Texture
     if (texture_){
-        GLint tex = glGetUniformLocation(program, "texture_map");
-        glUniform1i(tex, 0); // Assign the first texture to the map
-        glActiveTexture(GL_TEXTURE0); 
-        glBindTexture(GL_TEXTURE_2D, texture_); // First texture we bind
-        // Define texture interpolation
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glUniform1i(locations.texture_map, 0); // Assign the first texture to the map
+        // First texture we bind; its mipmaps and filtering were set up
+        // when it was loaded
+        state->BindTexture(texture_->GetResource(), texture_->GetSampler());
     }
 
 	// Time vars
-	GLint timer_var = glGetUniformLocation(program, "timer");
 	double current_time = glfwGetTime();
-	glUniform1f(timer_var, (float)current_time);
+	glUniform1f(locations.timer, (float)current_time);
 	if (glm::length(color_) > 0.0f)
 	{
-		GLint start_var = glGetUniformLocation(program, "start");
-		glUniform1f(start_var, (float)start_time);
-		GLint end_var = glGetUniformLocation(program, "end");
-		glUniform1f(end_var, (float)end_time);
-		GLint momentum_var = glGetUniformLocation(program, "momentum");
-		glUniform3fv(momentum_var, 3, glm::value_ptr(momentum_));
-		GLint color_var = glGetUniformLocation(program, "object_color");
-		glUniform3fv(color_var, 1, glm::value_ptr(color_));
+		glUniform1f(locations.start, (float)start_time);
+		glUniform1f(locations.end, (float)end_time);
+		glUniform3fv(locations.momentum, 3, glm::value_ptr(momentum_));
+		glUniform3fv(locations.object_color, 1, glm::value_ptr(color_));
 	}
 }
 
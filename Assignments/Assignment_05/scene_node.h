@@ -11,6 +11,15 @@
 
 #include "resource.h"
 #include "camera.h"
+#include "render_state.h"
+#include "transform_store.h"
+
+// Projected radius in pixels below which geometry switches to its first
+// coarser level of detail; each further level starts at half the radius
+#define LOD_DETAIL_RADIUS 100.0f
+// Relative margin around the switch radii, so that objects near a switch
+// distance do not flip between levels every frame
+#define LOD_HYSTERESIS 0.15f
 
 namespace game {
 
@@ -22,7 +31,7 @@ namespace game {
             SceneNode(const std::string name, const Resource *geometry, const Resource *material, const Resource *texture = NULL);
 
             // Destructor
-            ~SceneNode();
+            virtual ~SceneNode();
             
             // Get name of node
             const std::string GetName(void) const;
@@ -32,6 +41,13 @@ namespace game {
             glm::quat GetOrientation(void) const;
             glm::vec3 GetScale(void) const;
             bool GetBlending(void) const;
+            // Get bounding sphere of node in world coordinates; returns false
+            // if the node has no bounds and should never be culled
+            virtual bool GetWorldBounds(glm::vec3 &center, float &radius) const;
+            // Get the transformation matrices of the node, recomputed only
+            // after the position, orientation or scale change
+            const glm::mat4 &GetWorldMatrix(void) const;
+            const glm::mat4 &GetNormalMatrix(void) const;
 
             // Set node attributes
             void SetPosition(glm::vec3 position);
@@ -48,35 +64,62 @@ namespace game {
             void Rotate(glm::quat rot);
             void Scale(glm::vec3 scale);
 
+            // Whether the resources of the node are loaded; nodes that are
+            // not ready are skipped when drawing
+            bool IsReady(void) const;
+
             // Draw the node according to scene parameters in 'camera'
-            // variable
-            virtual void Draw(Camera *camera, int effect_num);
+            // variable, changing only the OpenGL state that differs from
+            // the one recorded in 'state'
+            virtual void Draw(Camera *camera, RenderState *state);
+
+            // Select the level of detail of the geometry for the projected
+            // size of the node; called before drawing visible nodes
+            virtual void SelectLevelOfDetail(const Camera *camera);
 
             // Update the node
+            // Called concurrently for different nodes from the threads of
+            // the job system, so it may only modify this node (its own
+            // transformation included) and must not add or remove nodes,
+            // resources or transformations, or call OpenGL
             virtual void Update(void);
 
+            // Store holding the transformations of all scene nodes
+            static TransformStore &GetTransformStore(void);
+
             // OpenGL variables
             GLenum GetMode(void) const;
             GLuint GetArrayBuffer(void) const;
             GLuint GetElementArrayBuffer(void) const;
+            GLuint GetVertexArray(void) const;
             GLsizei GetSize(void) const;
             GLuint GetMaterial(void) const;
+            GLuint GetTexture(void) const;
+
+        protected:
+            // Issue the draw call for the geometry, once the material and
+            // its inputs are set up
+            virtual void DrawGeometry(RenderState *state);
+
+            // Level of detail to use for a projected radius (in pixels),
+            // given the level used so far
+            static int ChooseLevelOfDetail(float projected_radius, int current_level, int num_levels);
 
         private:
             std::string name_; // Name of the scene node
-            GLuint array_buffer_; // References to geometry: vertex and array buffers
-            GLuint element_array_buffer_;
+            const Resource *geometry_; // Vertex array and buffers of the geometry
+            int lod_level_; // Level of detail of the geometry being drawn
             GLenum mode_; // Type of geometry
-            GLsizei size_; // Number of primitives in geometry
-            GLuint material_; // Reference to shader program
-            GLuint texture_; // Reference to texture resource
-            glm::vec3 position_; // Position of node
-            glm::quat orientation_; // Orientation of node
-            glm::vec3 scale_; // Scale of node
+            const Resource *material_; // Shader program and its input locations
+            const Resource *texture_; // Texture resource, or NULL
+            // Position, orientation, scale and cached matrices of node,
+            // kept in the transform store
+            TransformHandle transform_;
             bool blending_; // Draw with blending or not
 
-            // Set matrices that transform the node in a shader program
-            void SetupShader(GLuint program);
+            // Set matrices that transform the node in the current shader
+            // program, given the locations cached for its material
+            void SetupShader(const MaterialLocations &locations, RenderState *state);
 
 			float start_time;
 			float end_time;
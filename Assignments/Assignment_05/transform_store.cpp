@@ -0,0 +1,167 @@
+#include "transform_store.h"
+
+namespace game {
+
+TransformStore::TransformStore(void){
+}
+
+
+TransformStore::~TransformStore(){
+}
+
+
+TransformHandle TransformStore::Allocate(void){
+
+    TransformHandle handle;
+    if (free_.size() > 0){
+        handle = free_.back();
+        free_.pop_back();
+    } else {
+        handle = (TransformHandle) position_.size();
+        position_.push_back(glm::vec3(0.0, 0.0, 0.0));
+        orientation_.push_back(glm::quat());
+        scale_.push_back(glm::vec3(1.0, 1.0, 1.0));
+        world_matrix_.push_back(glm::mat4(1.0));
+        normal_matrix_.push_back(glm::mat4(1.0));
+        dirty_.push_back(1);
+        return handle;
+    }
+
+    position_[handle] = glm::vec3(0.0, 0.0, 0.0);
+    orientation_[handle] = glm::quat();
+    scale_[handle] = glm::vec3(1.0, 1.0, 1.0);
+    dirty_[handle] = 1;
+    return handle;
+}
+
+
+void TransformStore::Release(TransformHandle handle){
+
+    free_.push_back(handle);
+}
+
+
+int TransformStore::GetSize(void) const {
+
+    return (int) position_.size();
+}
+
+
+glm::vec3 TransformStore::GetPosition(TransformHandle handle) const {
+
+    return position_[handle];
+}
+
+
+glm::quat TransformStore::GetOrientation(TransformHandle handle) const {
+
+    return orientation_[handle];
+}
+
+
+glm::vec3 TransformStore::GetScale(TransformHandle handle) const {
+
+    return scale_[handle];
+}
+
+
+void TransformStore::SetPosition(TransformHandle handle, glm::vec3 position){
+
+    position_[handle] = position;
+    dirty_[handle] = 1;
+}
+
+
+void TransformStore::SetOrientation(TransformHandle handle, glm::quat orientation){
+
+    orientation_[handle] = orientation;
+    dirty_[handle] = 1;
+}
+
+
+void TransformStore::SetScale(TransformHandle handle, glm::vec3 scale){
+
+    scale_[handle] = scale;
+    dirty_[handle] = 1;
+}
+
+
+void TransformStore::Translate(TransformHandle handle, glm::vec3 trans){
+
+    position_[handle] += trans;
+    dirty_[handle] = 1;
+}
+
+
+void TransformStore::Rotate(TransformHandle handle, glm::quat rot){
+
+    orientation_[handle] *= rot;
+    orientation_[handle] = glm::normalize(orientation_[handle]);
+    dirty_[handle] = 1;
+}
+
+
+void TransformStore::Scale(TransformHandle handle, glm::vec3 scale){
+
+    scale_[handle] *= scale;
+    dirty_[handle] = 1;
+}
+
+
+const glm::mat4 &TransformStore::GetWorldMatrix(TransformHandle handle){
+
+    if (dirty_[handle]){
+        UpdateMatrix(handle);
+    }
+    return world_matrix_[handle];
+}
+
+
+const glm::mat4 &TransformStore::GetNormalMatrix(TransformHandle handle){
+
+    if (dirty_[handle]){
+        UpdateMatrix(handle);
+    }
+    return normal_matrix_[handle];
+}
+
+
+void TransformStore::UpdateMatrices(int begin, int end){
+
+    for (int i = begin; i < end; i++){
+        if (dirty_[i]){
+            UpdateMatrix(i);
+        }
+    }
+}
+
+
+void TransformStore::UpdateMatrices(void){
+
+    UpdateMatrices(0, (int) position_.size());
+}
+
+
+void TransformStore::UpdateMatrix(int index){
+
+    // World matrix: translation * rotation * scaling, built directly from
+    // the columns of the rotation matrix
+    glm::mat3 rotation = glm::mat3_cast(orientation_[index]);
+    glm::vec3 scale = scale_[index];
+    glm::mat4 &world = world_matrix_[index];
+    glm::mat4 &normal = normal_matrix_[index];
+    for (int i = 0; i < 3; i++){
+        world[i] = glm::vec4(rotation[i] * scale[i], 0.0);
+        // The inverse transpose of rotation * scaling is
+        // rotation * inverse(scaling), so there is no need for a general
+        // inverse. A zero scale (hidden node) gives a zero column
+        float inv_scale = (scale[i] != 0.0f) ? 1.0f / scale[i] : 0.0f;
+        normal[i] = glm::vec4(rotation[i] * inv_scale, 0.0);
+    }
+    world[3] = glm::vec4(position_[index], 1.0);
+    normal[3] = glm::vec4(0.0, 0.0, 0.0, 1.0);
+
+    dirty_[index] = 0;
+}
+
+} // namespace game
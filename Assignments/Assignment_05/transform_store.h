@@ -0,0 +1,76 @@
+#ifndef TRANSFORM_STORE_H_
+#define TRANSFORM_STORE_H_
+
+#include <vector>
+#include <glm/glm.hpp>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/quaternion.hpp>
+
+namespace game {
+
+    // Reference to one transformation in a store
+    typedef int TransformHandle;
+
+    // Storage for the transformations of many scene nodes
+    // Each component (position, orientation, scale, matrices) is kept in
+    // its own contiguous array, so that loops over all transformations
+    // only touch the data they need
+    class TransformStore {
+
+        public:
+            TransformStore(void);
+            ~TransformStore();
+
+            // Allocate a transformation: origin, no rotation, unit scale
+            TransformHandle Allocate(void);
+            // Release a transformation so that its slot can be reused
+            void Release(TransformHandle handle);
+            // Number of slots, including released ones
+            int GetSize(void) const;
+
+            // Get transformation components
+            glm::vec3 GetPosition(TransformHandle handle) const;
+            glm::quat GetOrientation(TransformHandle handle) const;
+            glm::vec3 GetScale(TransformHandle handle) const;
+
+            // Set transformation components
+            void SetPosition(TransformHandle handle, glm::vec3 position);
+            void SetOrientation(TransformHandle handle, glm::quat orientation);
+            void SetScale(TransformHandle handle, glm::vec3 scale);
+
+            // Perform transformations
+            void Translate(TransformHandle handle, glm::vec3 trans);
+            void Rotate(TransformHandle handle, glm::quat rot);
+            void Scale(TransformHandle handle, glm::vec3 scale);
+
+            // Get the matrices of a transformation, recomputing them if
+            // the transformation changed
+            const glm::mat4 &GetWorldMatrix(TransformHandle handle);
+            const glm::mat4 &GetNormalMatrix(TransformHandle handle);
+
+            // Recompute the matrices of all changed transformations in the
+            // range [begin, end)
+            void UpdateMatrices(int begin, int end);
+            // Recompute the matrices of all changed transformations
+            void UpdateMatrices(void);
+
+        private:
+            std::vector<glm::vec3> position_;
+            std::vector<glm::quat> orientation_;
+            std::vector<glm::vec3> scale_;
+            std::vector<glm::mat4> world_matrix_;
+            std::vector<glm::mat4> normal_matrix_;
+            // Matrices need to be recomputed (one byte per slot, so that
+            // slots can be updated independently)
+            std::vector<unsigned char> dirty_;
+            // Released slots
+            std::vector<TransformHandle> free_;
+
+            // Recompute the matrices of one transformation
+            void UpdateMatrix(int index);
+
+    }; // class TransformStore
+
+} // namespace game
+
+#endif // TRANSFORM_STORE_H_
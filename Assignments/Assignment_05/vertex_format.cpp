@@ -0,0 +1,90 @@
+#include <cstring>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "vertex_format.h"
+#include "resource.h"
+
+namespace game {
+
+// Position, normal, color and texture coordinates as floats
+static const VertexFormat full_vertex_format = {
+    11*sizeof(GLfloat), 4, {
+        {VERTEX_ATTRIBUTE_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0, 3},
+        {NORMAL_ATTRIBUTE_LOCATION, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), 3, 3},
+        {COLOR_ATTRIBUTE_LOCATION, 3, GL_FLOAT, GL_FALSE, 6*sizeof(GLfloat), 6, 3},
+        {UV_ATTRIBUTE_LOCATION, 2, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), 9, 2}
+    }
+};
+
+// The position takes four half floats so that the following attributes
+// stay aligned to four bytes; the shaders only read the first three
+static const VertexFormat compact_vertex_format = {
+    20, 4, {
+        {VERTEX_ATTRIBUTE_LOCATION, 4, GL_HALF_FLOAT, GL_FALSE, 0, 0, 3},
+        {NORMAL_ATTRIBUTE_LOCATION, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 8, 3, 3},
+        {COLOR_ATTRIBUTE_LOCATION, 4, GL_UNSIGNED_BYTE, GL_TRUE, 12, 6, 3},
+        {UV_ATTRIBUTE_LOCATION, 2, GL_HALF_FLOAT, GL_FALSE, 16, 9, 2}
+    }
+};
+
+
+const VertexFormat &GetVertexFormat(VertexFormatType type){
+
+    if (type == CompactVertexFormat){
+        return compact_vertex_format;
+    }
+    return full_vertex_format;
+}
+
+
+void SetupVertexAttributes(const VertexFormat &format){
+
+    for (int i = 0; i < format.num_attributes; i++){
+        const VertexAttributeFormat &att = format.attribute[i];
+        glVertexAttribPointer(att.location, att.size, att.type, att.normalized, format.stride, (void *) (size_t) att.offset);
+        glEnableVertexAttribArray(att.location);
+    }
+}
+
+
+void EncodeVertices(const GLfloat *vertex, GLsizei num_vertices, const VertexFormat &format, std::vector<unsigned char> &output){
+
+    output.assign((size_t) num_vertices * format.stride, 0);
+
+    for (GLsizei v = 0; v < num_vertices; v++){
+        const GLfloat *src = vertex + (size_t) v * 11;
+        unsigned char *dst = &output[(size_t) v * format.stride];
+        for (int i = 0; i < format.num_attributes; i++){
+            const VertexAttributeFormat &att = format.attribute[i];
+            // Components missing from the source are 0, except w, which
+            // is 1 as in OpenGL's default
+            GLfloat value[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+            for (int c = 0; c < att.source_size; c++){
+                value[c] = src[att.source_offset + c];
+            }
+
+            unsigned char *out = dst + att.offset;
+            if (att.type == GL_FLOAT){
+                memcpy(out, value, att.size * sizeof(GLfloat));
+            } else if (att.type == GL_HALF_FLOAT){
+                for (int c = 0; c < att.size; c++){
+                    GLushort half = glm::packHalf1x16(value[c]);
+                    memcpy(out + c * sizeof(GLushort), &half, sizeof(GLushort));
+                }
+            } else if (att.type == GL_INT_2_10_10_10_REV){
+                // Only the three signed 10-bit components are used
+                GLuint packed = glm::packSnorm3x10_1x2(glm::vec4(value[0], value[1], value[2], 0.0f));
+                memcpy(out, &packed, sizeof(GLuint));
+            } else if (att.type == GL_UNSIGNED_BYTE){
+                for (int c = 0; c < att.size; c++){
+                    float clamped = (value[c] < 0.0f) ? 0.0f : ((value[c] > 1.0f) ? 1.0f : value[c]);
+                    out[c] = (unsigned char) floorf(clamped * 255.0f + 0.5f);
+                }
+            }
+        }
+    }
+}
+
+} // namespace game
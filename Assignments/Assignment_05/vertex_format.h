@@ -0,0 +1,48 @@
+#ifndef VERTEX_FORMAT_H_
+#define VERTEX_FORMAT_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+    // Vertex layouts available for geometry
+    // FullVertexFormat: 11 floats (44 bytes) per vertex
+    // CompactVertexFormat: 20 bytes per vertex; half-float position and
+    // texture coordinates, normal packed in 10 bits per component, and 8
+    // bits per color component (so colors are clamped to [0, 1])
+    typedef enum VertexFormatTypes { FullVertexFormat, CompactVertexFormat } VertexFormatType;
+
+    // Layout of one attribute within a vertex
+    struct VertexAttributeFormat {
+        GLuint location; // Attribute location (see resource.h)
+        GLint size; // Number of components
+        GLenum type; // Type of the components in the buffer
+        GLboolean normalized; // Integers are mapped to [0, 1] or [-1, 1]
+        GLsizei offset; // Offset in bytes within the vertex
+        int source_offset; // Offset of the attribute in the 11-float vertex
+        int source_size; // Number of components in the 11-float vertex
+    };
+
+    // Layout of an interleaved vertex
+    struct VertexFormat {
+        GLsizei stride; // Size of a vertex in bytes
+        int num_attributes;
+        VertexAttributeFormat attribute[4];
+    };
+
+    // Description of a vertex format
+    const VertexFormat &GetVertexFormat(VertexFormatType type);
+
+    // Describe the vertex layout of the geometry in the bound array buffer
+    // to the bound vertex array
+    void SetupVertexAttributes(const VertexFormat &format);
+
+    // Convert vertices given as 11 floats (position, normal, color and
+    // texture coordinates) to a vertex format
+    void EncodeVertices(const GLfloat *vertex, GLsizei num_vertices, const VertexFormat &format, std::vector<unsigned char> &output);
+
+} // namespace game
+
+#endif // VERTEX_FORMAT_H_